@@ -0,0 +1,45 @@
+#ifndef LINKED_PTR_BENCH_H
+#define LINKED_PTR_BENCH_H
+
+// Minimal timing helpers shared by the benchmarks.
+// Build with -DCMAKE_BUILD_TYPE=Release to get meaningful numbers.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace bench {
+
+// keeps the optimizer from dropping a computed value
+template <typename T>
+void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <typename F>
+double seconds(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+inline void report(const std::string& name, double seconds, std::size_t ops = 0) {
+    std::cout << std::left << std::setw(48) << name << std::right << std::fixed
+              << std::setprecision(3) << std::setw(10) << seconds * 1e3 << " ms";
+    if (ops != 0)
+        std::cout << std::setw(12) << std::setprecision(2) << seconds * 1e9 / ops << " ns/op";
+    std::cout << std::endl;
+}
+
+// size given as the first command line argument, or the default
+inline std::size_t size_arg(int argc, char** argv, std::size_t fallback) {
+    return argc > 1 ? static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10)) : fallback;
+}
+
+} // namespace bench
+
+#endif // LINKED_PTR_BENCH_H
@@ -0,0 +1,80 @@
+// Parsing a large CSV into fields which outlive the receive buffer:
+// buffer_slice views vs std::string copies.
+// usage: buffer_bench [lines]   (default 10^6)
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "linked_buffer.h"
+
+using namespace smart_ptr;
+
+namespace {
+
+const std::size_t chunk_size = 1 << 16;
+
+std::string make_csv(std::size_t lines) {
+    std::string csv;
+    for (std::size_t i = 0; i < lines; ++i) {
+        csv += std::to_string(1600000000 + i) + ",host-" + std::to_string(i % 97) + ",cpu.usage.system,"
+               + std::to_string(i % 1000) + "." + std::to_string(i % 7) + "\n";
+    }
+    return csv;
+}
+
+// feeds the text in chunks like a socket, a line never spans two chunks
+template <typename OnChunk>
+void receive(const std::string& csv, OnChunk&& on_chunk) {
+    std::size_t begin = 0;
+    while (begin < csv.size()) {
+        std::size_t end = std::min(csv.size(), begin + chunk_size);
+        if (end < csv.size())
+            end = csv.rfind('\n', end - 1) + 1;
+        linked_buffer buffer(end - begin);
+        std::copy(csv.begin() + begin, csv.begin() + end, buffer.data());
+        on_chunk(buffer);
+        begin = end;
+    }
+}
+
+template <typename Field, typename Make>
+std::vector<Field> parse(const std::string& csv, std::size_t expected, Make&& make) {
+    std::vector<Field> fields;
+    fields.reserve(expected);
+    receive(csv, [&](const linked_buffer& buffer) {
+        const char* data = buffer.data();
+        std::size_t start = 0;
+        for (std::size_t i = 0; i < buffer.size(); ++i) {
+            if (data[i] == ',' || data[i] == '\n') {
+                fields.push_back(make(buffer, start, i - start));
+                start = i + 1;
+            }
+        }
+    });
+    return fields;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t lines = bench::size_arg(argc, argv, 1000000);
+    std::string csv = make_csv(lines);
+    std::cout << "lines: " << lines << ", bytes: " << csv.size() << std::endl;
+
+    std::size_t count = 0;
+    bench::report("fields as std::string copies", bench::seconds([&] {
+        auto fields = parse<std::string>(csv, 4 * lines, [](const linked_buffer& b, std::size_t offset, std::size_t size) {
+            return std::string(b.data() + offset, size);
+        });
+        count = fields.size();
+    }), 4 * lines);
+
+    bench::report("fields as buffer_slice", bench::seconds([&] {
+        auto fields = parse<buffer_slice>(csv, 4 * lines, [](const linked_buffer& b, std::size_t offset, std::size_t size) {
+            return b.slice(offset, size);
+        });
+        count -= fields.size();
+    }), 4 * lines);
+    return count == 0 ? 0 : 1;
+}
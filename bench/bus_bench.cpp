@@ -0,0 +1,125 @@
+// Fan-out of messages to 1, 16 and 256 subscribers: message_bus
+// (one splice per publish) vs a linked_ptr copy and a shared_ptr copy
+// per subscriber, and the bus with a consumer thread.
+// usage: bus_bench [messages]   (default 10^5)
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "message_bus.h"
+
+using namespace smart_ptr;
+
+namespace {
+
+const std::size_t batch = 64;
+
+struct message {
+    std::size_t id;
+    char payload[56];
+};
+
+// per subscriber queues of copies, drained in batches like the bus
+template <typename Ptr>
+std::size_t copies(std::size_t messages, std::size_t subscribers) {
+    std::vector<std::vector<Ptr>> queues(subscribers);
+    for (auto& q : queues)
+        q.reserve(batch);
+    std::size_t sum = 0;
+    for (std::size_t i = 0; i < messages; i += batch) {
+        for (std::size_t j = i; j < i + batch; ++j) {
+            Ptr m(new message{j, {}});
+            for (auto& q : queues)
+                q.push_back(m);
+        }
+        for (auto& q : queues) {
+            for (auto const& m : q)
+                sum += m->id;
+            q.clear();
+        }
+    }
+    return sum;
+}
+
+std::size_t bus(std::size_t messages, std::size_t subscribers) {
+    message_bus<message> b(batch);
+    std::vector<message_bus<message>::subscriber> subs;
+    for (std::size_t k = 0; k < subscribers; ++k)
+        subs.push_back(b.subscribe());
+    std::vector<linked_ptr<const message>> messages_batch(batch);
+    std::size_t sum = 0;
+    for (std::size_t i = 0; i < messages; i += batch) {
+        for (std::size_t j = 0; j < batch; ++j)
+            messages_batch[j].reset(new message{i + j, {}});
+        b.publish(messages_batch.begin(), messages_batch.end());
+        for (auto& s : subs)
+            s.poll([&](const message& m) { sum += m.id; });
+    }
+    return sum;
+}
+
+std::size_t threaded_bus(std::size_t messages, std::size_t subscribers) {
+    message_bus<message> b(1024);
+    std::vector<message_bus<message>::subscriber> subs;
+    for (std::size_t k = 0; k < subscribers; ++k)
+        subs.push_back(b.subscribe());
+
+    std::atomic<bool> done(false);
+    std::size_t sum = 0;
+    std::thread consumer([&] {
+        for (;;) {
+            bool finished = done.load();
+            std::size_t n = 0;
+            for (auto& s : subs)
+                n += s.poll([&](const message& m) { sum += m.id; });
+            if (n == 0) {
+                if (finished)
+                    break;
+                std::this_thread::yield();
+            }
+        }
+    });
+    for (std::size_t i = 0; i < messages; ++i) {
+        linked_ptr<const message> m(new message{i, {}});
+        // wait for the slowest subscriber instead of dropping
+        while (b.publish(m) == 0)
+            std::this_thread::yield();
+    }
+    done = true;
+    consumer.join();
+    return sum;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t messages = bench::size_arg(argc, argv, 100000) / batch * batch;
+    std::cout << "messages: " << messages << std::endl;
+
+    for (std::size_t subscribers : {1, 16, 256}) {
+        std::size_t deliveries = messages * subscribers;
+        std::string suffix = ", " + std::to_string(subscribers) + " subscribers";
+        std::size_t sum = 0;
+        bench::report("linked_ptr copy per subscriber" + suffix, bench::seconds([&] {
+            sum = copies<linked_ptr<const message>>(messages, subscribers);
+        }), deliveries);
+        bench::report("shared_ptr copy per subscriber" + suffix, bench::seconds([&] {
+            sum -= copies<std::shared_ptr<const message>>(messages, subscribers);
+        }), deliveries);
+        bench::report("message_bus" + suffix, bench::seconds([&] {
+            sum += bus(messages, subscribers);
+        }), deliveries);
+        bench::do_not_optimize(sum);
+    }
+
+    // the queues are large enough to never drop with one subscriber
+    std::size_t sum = 0;
+    bench::report("message_bus, consumer thread, 1 subscriber", bench::seconds([&] {
+        sum = threaded_bus(messages, 1);
+    }), messages);
+    return sum == messages * (messages - 1) / 2 ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+// linked_cache: hit path and the cost of the eviction scan when part of
+// the entries is still held outside the cache.
+// usage: cache_bench [entries]   (default 10^6, try 10^7)
+
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "linked_cache.h"
+
+using namespace smart_ptr;
+
+int main(int argc, char** argv) {
+    std::size_t n = bench::size_arg(argc, argv, 1000000);
+    std::cout << "entries: " << n << std::endl;
+
+    linked_cache<std::size_t, long> cache(n * sizeof(long), 64);
+    bench::report("fill", bench::seconds([&] {
+        for (std::size_t i = 0; i < n; ++i)
+            cache.put(i, linked_ptr<long>(new long(i)));
+    }), n);
+
+    std::mt19937_64 random(42);
+    std::vector<std::size_t> keys(n);
+    for (std::size_t& key : keys)
+        key = random() % n;
+
+    // each shard holds capacity / 64, a shard given more keys than that
+    // has evicted some of them
+    long sum = 0;
+    std::size_t hits = 0;
+    bench::report("get (hit)", bench::seconds([&] {
+        for (std::size_t key : keys) {
+            linked_ptr<long> value = cache.get(key);
+            if (value) {
+                sum += *value;
+                ++hits;
+            }
+        }
+    }), n);
+    std::cout << "hits: " << hits << " of " << n << std::endl;
+    bench::do_not_optimize(sum);
+
+    for (std::size_t pinned_percent : {0, 50, 90}) {
+        std::vector<linked_ptr<long>> pinned;
+        for (std::size_t i = 0; i < n; ++i) {
+            linked_ptr<long> value = cache.get(i);
+            if (value && random() % 100 < pinned_percent)
+                pinned.push_back(value);
+        }
+        std::size_t next = n * (pinned_percent + 1);
+        bench::report("put with eviction, " + std::to_string(pinned_percent) + "% pinned",
+                      bench::seconds([&] {
+                          for (std::size_t i = 0; i < n; ++i)
+                              cache.put(next + i, linked_ptr<long>(new long(i)));
+                      }), n);
+        pinned.clear();
+        cache.shrink();
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+// Fanning one pointer out into a large array: one copy per element
+// vs clone_into, which links the new owners among themselves and
+// splices them into the ring at once.
+// usage: clone_bench [elements]   (default 10^6)
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "bench.h"
+#include "linked_ptr.h"
+
+using namespace smart_ptr;
+
+int main(int argc, char** argv) {
+    std::size_t size = bench::size_arg(argc, argv, 1000000);
+    const std::size_t rounds = 10;
+    std::cout << "elements: " << size << ", rounds: " << rounds << std::endl;
+
+    linked_ptr<int> p(new int(42));
+    std::vector<linked_ptr<int>> out(size);
+    bench::report("copy constructors (vector of copies)", bench::seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            std::vector<linked_ptr<int>> copies(size, p);
+            bench::do_not_optimize(copies.data());
+        }
+    }), rounds * size);
+
+    bench::report("copy assignment (std::fill)", bench::seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            std::fill(out.begin(), out.end(), p);
+            bench::do_not_optimize(out.data());
+            for (auto& o : out)
+                o.reset();
+        }
+    }), rounds * size);
+
+    bench::report("clone_into", bench::seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            p.clone_into(out.begin(), out.end());
+            bench::do_not_optimize(out.data());
+            for (auto& o : out)
+                o.reset();
+        }
+    }), rounds * size);
+
+    std::shared_ptr<int> s(new int(42));
+    bench::report("shared_ptr copy constructors", bench::seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            std::vector<std::shared_ptr<int>> copies(size, s);
+            bench::do_not_optimize(copies.data());
+        }
+    }), rounds * size);
+    return p.unique() ? 0 : 1;
+}
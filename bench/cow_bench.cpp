@@ -0,0 +1,124 @@
+// Fan-out pipeline passing a large value between stages: defensive
+// copies vs shared_ptr based copy-on-write vs cow (linked_ptr::unique).
+// usage: cow_bench [messages]   (default 2000)
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "cow.h"
+
+using namespace smart_ptr;
+
+namespace {
+
+using payload = std::vector<int>;
+
+const std::size_t payload_size = 1 << 14;
+const std::size_t fan_out = 8;
+const std::size_t stages = 4;
+// one stage out of write_period modifies the value
+const unsigned write_period = 10;
+
+std::size_t clones = 0;
+
+struct always_copy {
+    explicit always_copy(const payload& p) : value(p) {}
+
+    always_copy(const always_copy& other) : value(other.value) {
+        ++clones;
+    }
+
+    always_copy& operator=(const always_copy& other) {
+        value = other.value;
+        ++clones;
+        return *this;
+    }
+
+    const payload& get() const {
+        return value;
+    }
+
+    payload& write() {
+        return value;
+    }
+
+    payload value;
+};
+
+struct shared_cow {
+    explicit shared_cow(const payload& p) : value(std::make_shared<payload>(p)) {}
+
+    const payload& get() const {
+        return *value;
+    }
+
+    payload& write() {
+        if (value.use_count() != 1) {
+            value = std::make_shared<payload>(*value);
+            ++clones;
+        }
+        return *value;
+    }
+
+    std::shared_ptr<payload> value;
+};
+
+struct linked_cow {
+    explicit linked_cow(const payload& p) : value(p) {}
+
+    const payload& get() const {
+        return *value;
+    }
+
+    payload& write() {
+        clones += value.shared();
+        return value.write();
+    }
+
+    cow<payload> value;
+};
+
+template <typename Value>
+long run(std::size_t messages) {
+    std::mt19937 random(1);
+    payload source(payload_size, 1);
+    long sum = 0;
+    for (std::size_t m = 0; m < messages; ++m) {
+        Value message(source);
+        std::vector<Value> branches(fan_out, message);
+        for (Value& branch : branches) {
+            for (std::size_t stage = 0; stage < stages; ++stage) {
+                Value next = branch;
+                if (random() % write_period == 0)
+                    next.write()[random() % payload_size] += 1;
+                sum += next.get()[m % payload_size];
+                branch = next;
+            }
+        }
+    }
+    return sum;
+}
+
+template <typename Value>
+void report(const char* name, std::size_t messages) {
+    clones = 0;
+    long sum = 0;
+    double t = bench::seconds([&] { sum = run<Value>(messages); });
+    bench::do_not_optimize(sum);
+    bench::report(name, t, messages);
+    std::cout << "    clones: " << clones << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t messages = bench::size_arg(argc, argv, 2000);
+    std::cout << "messages: " << messages << ", fan-out " << fan_out << ", " << stages
+              << " stages, payload " << payload_size * sizeof(int) / 1024 << " KiB" << std::endl;
+    report<always_copy>("always copy", messages);
+    report<shared_cow>("shared_ptr copy-on-write", messages);
+    report<linked_cow>("cow (linked_ptr::unique)", messages);
+    return 0;
+}
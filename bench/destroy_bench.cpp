@@ -0,0 +1,71 @@
+// Tearing down large arrays of linked_ptr: the element destructors
+// one by one vs destroy_range (linked_ptr_vector), for a dense ring
+// (all the owners of one object), small rings shuffled inside the
+// array, and a sparse one (every owner's neighbours outside it).
+// usage: destroy_bench [elements]   (default 10^7)
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "linked_ptr_vector.h"
+
+using namespace smart_ptr;
+
+namespace {
+
+// fills both containers the same way, then times their teardown
+template <typename Fill>
+void compare(const std::string& name, std::size_t size, Fill&& fill) {
+    std::vector<linked_ptr<int>> keep;
+    {
+        std::vector<linked_ptr<int>> v(size);
+        fill(v.data(), keep);
+        bench::report(name + ", destructors", bench::seconds([&] {
+            std::vector<linked_ptr<int>>().swap(v);
+        }), size);
+    }
+    keep.clear();
+    {
+        linked_ptr_vector<int> v(size);
+        fill(v.data(), keep);
+        bench::report(name + ", destroy_range", bench::seconds([&] {
+            v.clear();
+        }), size);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t size = bench::size_arg(argc, argv, 10000000);
+    std::cout << "elements: " << size << std::endl;
+
+    compare("dense ring", size, [&](linked_ptr<int>* out, std::vector<linked_ptr<int>>&) {
+        linked_ptr<int> p(new int(1));
+        p.clone_into(out, out + size);
+    });
+
+    // rings of 4 owners, inside the array only, in random places
+    std::vector<std::size_t> order(size);
+    for (std::size_t i = 0; i < size; ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(1));
+    compare("rings of 4 inside, shuffled", size, [&](linked_ptr<int>* out, std::vector<linked_ptr<int>>&) {
+        for (std::size_t i = 0; i + 4 <= size; i += 4) {
+            out[order[i]].reset(new int(int(i)));
+            for (std::size_t j = 1; j < 4; ++j)
+                out[order[i + j]] = out[order[i]];
+        }
+    });
+
+    compare("sparse, neighbours outside", size, [&](linked_ptr<int>* out, std::vector<linked_ptr<int>>& keep) {
+        keep.resize(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            keep[i].reset(new int(int(i)));
+            out[order[i]] = keep[i];
+        }
+    });
+    return 0;
+}
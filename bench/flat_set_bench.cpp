@@ -0,0 +1,73 @@
+// Sets of owners from 10^3 entries up to the given size: building from
+// a batch and looking up every object by raw pointer, in
+// linked_ptr_flat_set, std::set with ptr_less and std::unordered_set
+// with ptr_hash (which needs the C++20 lookup).
+// usage: flat_set_bench [max entries]   (default 10^6, 10^8 needs ~10 GB)
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "bench.h"
+#include "linked_ptr_flat_set.h"
+
+using namespace smart_ptr;
+
+namespace {
+
+std::string entries(std::size_t size) {
+    return ", 10^" + std::to_string(static_cast<int>(std::log10(size) + 0.5));
+}
+
+// builds the set from owners and looks up each key
+template <typename Set, typename Lookup>
+void run(const std::string& name, const std::vector<linked_ptr<int>>& owners,
+         const std::vector<int*>& keys, Lookup&& lookup) {
+    std::size_t found = 0;
+    {
+        Set set;
+        bench::report(name + " insert" + entries(owners.size()), bench::seconds([&] {
+            set.insert(owners.begin(), owners.end());
+        }), owners.size());
+        bench::report(name + " find" + entries(owners.size()), bench::seconds([&] {
+            for (int* key : keys)
+                found += lookup(set, key);
+        }), keys.size());
+    }
+    bench::do_not_optimize(found);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t max = bench::size_arg(argc, argv, 1000000);
+
+    for (std::size_t size = 1000; size <= max; size *= 10) {
+        std::vector<linked_ptr<int>> owners(size);
+        for (std::size_t i = 0; i < size; ++i)
+            owners[i].reset(new int(static_cast<int>(i)));
+        std::shuffle(owners.begin(), owners.end(), std::mt19937(42));
+        // at least 10^6 lookups, in another order
+        std::vector<int*> keys;
+        for (std::size_t i = 0; i < std::max<std::size_t>(size, 1000000); ++i)
+            keys.push_back(owners[(i * 7919) % size].get());
+
+        run<linked_ptr_flat_set<int>>("linked_ptr_flat_set", owners, keys, [](const linked_ptr_flat_set<int>& s, int* key) {
+            return s.count(key);
+        });
+        run<std::set<linked_ptr<int>, ptr_less>>("std::set", owners, keys, [](const std::set<linked_ptr<int>, ptr_less>& s, int* key) {
+            return s.count(key);
+        });
+#ifdef __cpp_lib_generic_unordered_lookup
+        using hashed = std::unordered_set<linked_ptr<int>, ptr_hash, ptr_equal>;
+        run<hashed>("std::unordered_set", owners, keys, [](const hashed& s, int* key) {
+            return s.count(key);
+        });
+#endif
+    }
+    return 0;
+}
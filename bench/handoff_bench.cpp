@@ -0,0 +1,105 @@
+// A three-stage pipeline: a producer builds the items, a worker
+// changes them, a sink adds them up and releases them. The stages pass
+// linked_ptrs through handoff_queue, or through a std::queue under a
+// mutex with the global_lock policy on the rings.
+// usage: handoff_bench [items]   (default 10^6)
+
+#include <mutex>
+#include <queue>
+#include <thread>
+
+#include "bench.h"
+#include "handoff_queue.h"
+
+using namespace smart_ptr;
+
+namespace {
+
+struct item {
+    std::size_t id;
+    std::size_t value;
+};
+
+template <typename Ptr>
+class locked_queue {
+public:
+    bool try_push(Ptr& ptr) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _items.push(ptr);
+        ptr.reset();
+        return true;
+    }
+
+    bool try_pop(Ptr& out) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_items.empty())
+            return false;
+        out = _items.front();
+        _items.pop();
+        return true;
+    }
+
+private:
+    std::mutex _mutex;
+    std::queue<Ptr> _items;
+};
+
+template <typename Queue, typename Ptr>
+void push(Queue& queue, Ptr& ptr) {
+    while (!queue.try_push(ptr))
+        std::this_thread::yield();
+}
+
+template <typename Queue, typename Ptr>
+void pop(Queue& queue, Ptr& out) {
+    while (!queue.try_pop(out))
+        std::this_thread::yield();
+}
+
+template <typename Ptr, typename Queue>
+std::size_t pipeline(std::size_t items) {
+    Queue produced;
+    Queue processed;
+    std::thread producer([&] {
+        for (std::size_t i = 0; i < items; ++i) {
+            Ptr p(new item{i, 0});
+            push(produced, p);
+        }
+    });
+    std::thread worker([&] {
+        Ptr p;
+        for (std::size_t i = 0; i < items; ++i) {
+            pop(produced, p);
+            p->value = p->id;
+            push(processed, p);
+        }
+    });
+
+    std::size_t sum = 0;
+    Ptr p;
+    for (std::size_t i = 0; i < items; ++i) {
+        pop(processed, p);
+        sum += p->value;
+    }
+    p.reset();
+    producer.join();
+    worker.join();
+    return sum;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t items = bench::size_arg(argc, argv, 1000000);
+    std::cout << "items: " << items << std::endl;
+
+    using locked_ptr = linked_ptr<item, linked_ptr_policy<default_deleter, global_lock>>;
+    std::size_t sum = 0;
+    bench::report("handoff_queue", bench::seconds([&] {
+        sum = pipeline<linked_ptr<item>, handoff_queue<item>>(items);
+    }), items);
+    bench::report("mutex queue, global_lock policy", bench::seconds([&] {
+        sum -= pipeline<locked_ptr, locked_queue<locked_ptr>>(items);
+    }), items);
+    return sum == 0 ? 0 : 1;
+}
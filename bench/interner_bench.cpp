@@ -0,0 +1,95 @@
+// linked_interner on a synthetic log-token corpus: interning throughput
+// and memory of the tokens held by the last records, vs std::string copies.
+// usage: interner_bench [tokens]   (default 10^7)
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "bench.h"
+#include "linked_interner.h"
+
+using namespace smart_ptr;
+
+namespace {
+
+// heap bytes of a string beyond the object itself
+std::size_t heap_bytes(const std::string& s) {
+    return s.capacity() > 15 ? s.capacity() + 1 : 0;
+}
+
+// "INFO service-12 user=u4711 GET /api/v1/items/318 200 12ms"
+std::vector<std::string> make_corpus(std::size_t n) {
+    static const char* levels[] = {"DEBUG", "INFO", "INFO", "INFO", "WARN", "ERROR"};
+    static const char* methods[] = {"GET", "GET", "GET", "POST", "PUT", "DELETE"};
+    static const char* statuses[] = {"200", "200", "200", "201", "204", "304", "404", "500"};
+    std::mt19937_64 random(7);
+    // Zipf-like: small ids are much more frequent
+    auto skewed = [&random](std::size_t range) {
+        double u = std::uniform_real_distribution<double>(0, 1)(random);
+        return static_cast<std::size_t>(std::pow(static_cast<double>(range), u)) - 1;
+    };
+
+    std::vector<std::string> tokens;
+    tokens.reserve(n);
+    while (tokens.size() < n) {
+        tokens.push_back(levels[random() % 6]);
+        tokens.push_back("service-" + std::to_string(skewed(64)));
+        tokens.push_back("user=u" + std::to_string(skewed(100000)));
+        tokens.push_back(methods[random() % 6]);
+        tokens.push_back("/api/v1/items/" + std::to_string(skewed(10000)));
+        tokens.push_back(statuses[random() % 8]);
+        tokens.push_back(std::to_string(skewed(2000)) + "ms");
+    }
+    tokens.resize(n);
+    return tokens;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t n = bench::size_arg(argc, argv, 10000000);
+    // tokens of the records still in memory
+    const std::size_t window = std::max<std::size_t>(1, std::min<std::size_t>(n, 1 << 20));
+    std::vector<std::string> corpus = make_corpus(n);
+    std::cout << "tokens: " << n << ", held: " << window << std::endl;
+
+    std::vector<std::string> copies(window);
+    bench::report("std::string copies", bench::seconds([&] {
+        for (std::size_t i = 0; i < n; ++i)
+            copies[i % window] = corpus[i];
+    }), n);
+
+    std::unordered_set<std::string> never_reclaimed;
+    bench::report("unordered_set<std::string> (no reclaiming)", bench::seconds([&] {
+        for (std::size_t i = 0; i < n; ++i)
+            bench::do_not_optimize(&*never_reclaimed.insert(corpus[i]).first);
+    }), n);
+
+    linked_interner<std::string> pool;
+    std::vector<linked_ptr<const std::string>> held(window);
+    bench::report("linked_interner", bench::seconds([&] {
+        for (std::size_t i = 0; i < n; ++i)
+            held[i % window] = pool.intern(corpus[i]);
+    }), n);
+    pool.sweep_all();
+
+    std::size_t copies_bytes = 0;
+    for (const std::string& s : copies)
+        copies_bytes += sizeof(std::string) + heap_bytes(s);
+    std::unordered_set<const std::string*> distinct;
+    for (auto const& p : held)
+        if (p)
+            distinct.insert(p.get());
+    std::size_t interned_bytes = window * sizeof(linked_ptr<const std::string>);
+    for (const std::string* s : distinct)
+        interned_bytes += sizeof(std::string) + heap_bytes(*s);
+
+    std::cout << "held as copies:   " << copies_bytes / 1024 << " KiB" << std::endl;
+    std::cout << "held as interned: " << interned_bytes / 1024 << " KiB (" << distinct.size()
+              << " distinct, " << pool.size() << " in pool)" << std::endl;
+    return 0;
+}
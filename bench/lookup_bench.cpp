@@ -0,0 +1,72 @@
+// Looking owners up by raw pointer: an unordered_set of linked_ptr with
+// the transparent ptr_hash/ptr_equal (C++20 lookup), a std::set with
+// ptr_less, an unordered_map keyed by the raw pointer next to the
+// owner, and find() with a copied owner as the key.
+// usage: lookup_bench [objects]   (default 10^6)
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "bench.h"
+#include "linked_ptr.h"
+
+using namespace smart_ptr;
+
+int main(int argc, char** argv) {
+    std::size_t size = bench::size_arg(argc, argv, 1000000);
+    std::cout << "objects: " << size << std::endl;
+
+    std::vector<linked_ptr<int>> owners(size);
+    for (std::size_t i = 0; i < size; ++i)
+        owners[i].reset(new int(static_cast<int>(i)));
+    std::vector<int*> keys(size);
+    std::transform(owners.begin(), owners.end(), keys.begin(), [](const linked_ptr<int>& p) { return p.get(); });
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+
+    std::size_t found = 0;
+
+#ifdef __cpp_lib_generic_unordered_lookup
+    std::unordered_set<linked_ptr<int>, ptr_hash, ptr_equal> transparent(owners.begin(), owners.end());
+    bench::report("unordered_set, ptr_hash, find(T*)", bench::seconds([&] {
+        for (int* key : keys)
+            found += transparent.count(key);
+    }), size);
+#else
+    std::cout << "unordered_set, ptr_hash, find(T*): needs C++20" << std::endl;
+#endif
+
+    std::set<linked_ptr<int>, ptr_less> ordered(owners.begin(), owners.end());
+    bench::report("std::set, ptr_less, find(T*)", bench::seconds([&] {
+        for (int* key : keys)
+            found += ordered.count(key);
+    }), size);
+
+    std::unordered_map<int*, linked_ptr<int>> by_key;
+    for (auto const& p : owners)
+        by_key.emplace(p.get(), p);
+    bench::report("unordered_map<T*, linked_ptr>, find(T*)", bench::seconds([&] {
+        for (int* key : keys)
+            found += by_key.count(key);
+    }), size);
+
+    // the key is an owner: a copy of one, since a second ring for the
+    // object would delete it twice
+    std::unordered_set<linked_ptr<int>> hashed(owners.begin(), owners.end());
+    std::vector<std::size_t> order(size);
+    for (std::size_t i = 0; i < size; ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+    bench::report("unordered_set, std::hash, find(copy)", bench::seconds([&] {
+        for (std::size_t i : order) {
+            linked_ptr<int> key(owners[i]);
+            found += hashed.count(key);
+        }
+    }), size);
+
+    bench::do_not_optimize(found);
+    return 0;
+}
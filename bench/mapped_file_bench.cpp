@@ -0,0 +1,111 @@
+// Streaming a file: read() into a buffer vs map_file, and the mapping
+// shared by the tasks of worker threads through slices.
+// usage: mapped_file_bench [megabytes]   (default 256)
+
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "mapped_file.h"
+
+using namespace smart_ptr;
+
+namespace {
+
+std::uint64_t checksum(const char* data, std::size_t size) {
+    std::uint64_t sum = 0;
+    for (std::size_t i = 0; i < size; ++i)
+        sum = sum * 31 + static_cast<unsigned char>(data[i]);
+    return sum;
+}
+
+int fail(const char* what, const char* path) {
+    std::perror(what);
+    unlink(path);
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t size = bench::size_arg(argc, argv, 256) << 20;
+    char path[] = "/tmp/linked_ptr_fileXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        std::perror("mapped_file_bench: mkstemp");
+        return 1;
+    }
+    std::vector<char> block(1 << 20);
+    for (std::size_t i = 0; i < block.size(); ++i)
+        block[i] = static_cast<char>(i * 7);
+    for (std::size_t written = 0; written < size; written += block.size()) {
+        if (write(fd, block.data(), block.size()) != static_cast<ssize_t>(block.size())) {
+            close(fd);
+            return fail("mapped_file_bench: write", path);
+        }
+    }
+    if (close(fd) != 0)
+        return fail("mapped_file_bench: close", path);
+    std::cout << "file: " << (size >> 20) << " MiB (in page cache)" << std::endl;
+
+    std::uint64_t expected = 0;
+    bench::report("read() into 1 MiB buffer", bench::seconds([&] {
+        int in = open(path, O_RDONLY);
+        ssize_t n;
+        while ((n = read(in, block.data(), block.size())) > 0)
+            expected += checksum(block.data(), n);
+        close(in);
+    }), size);
+
+    std::uint64_t actual = 0;
+    double elapsed = bench::seconds([&] {
+        buffer_slice file = map_file(path);
+        for (std::size_t offset = 0; offset < file.size(); offset += block.size()) {
+            buffer_slice part = file.slice(offset, block.size());
+            actual += checksum(part.data(), part.size());
+        }
+    });
+    if (actual != expected) {
+        std::cerr << "map_file: the mapping differs from read()" << std::endl;
+        unlink(path);
+        return 1;
+    }
+    bench::report("map_file", elapsed, size);
+
+    // linked_ptr rings are not thread-safe: the slices are made and
+    // dropped on this thread, the workers only read through them
+    std::size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::uint64_t> sums(size / block.size());
+    elapsed = bench::seconds([&] {
+        buffer_slice file = map_file(path);
+        std::vector<buffer_slice> tasks;
+        for (std::size_t offset = 0; offset < file.size(); offset += block.size())
+            tasks.push_back(file.slice(offset, block.size()));
+        std::vector<std::thread> threads;
+        for (std::size_t w = 0; w < workers; ++w) {
+            threads.emplace_back([&, w] {
+                for (std::size_t t = w; t < tasks.size(); t += workers)
+                    sums[t] = checksum(tasks[t].data(), tasks[t].size());
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+    });
+    // the blocks are the same, so are their sums
+    bool same = std::all_of(sums.begin(), sums.end(), [&](std::uint64_t sum) { return sum == sums[0]; });
+    if (!same || std::accumulate(sums.begin(), sums.end(), std::uint64_t(0)) != actual) {
+        std::cerr << "map_file, worker threads: the sums differ from one thread's" << std::endl;
+        unlink(path);
+        return 1;
+    }
+    bench::report("map_file, " + std::to_string(workers) + " worker threads", elapsed, size);
+
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,67 @@
+// Versioned metadata store: every version changes a few keys and keeps a
+// snapshot. persistent_map snapshots vs copying an std::unordered_map.
+// usage: persistent_map_bench [keys]   (default 10^6)
+
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bench.h"
+#include "persistent_map.h"
+
+using namespace smart_ptr;
+
+int main(int argc, char** argv) {
+    std::size_t n = bench::size_arg(argc, argv, 1000000);
+    const std::size_t versions = 50;
+    const std::size_t changes_per_version = 1000;
+    std::cout << "keys: " << n << ", versions: " << versions << " x " << changes_per_version
+              << " changes" << std::endl;
+
+    persistent_map<std::size_t, long> map;
+    std::unordered_map<std::size_t, long> plain;
+    bench::report("persistent_map insert", bench::seconds([&] {
+        for (std::size_t i = 0; i < n; ++i)
+            map.insert_or_assign(i, i);
+    }), n);
+    bench::report("std::unordered_map insert", bench::seconds([&] {
+        for (std::size_t i = 0; i < n; ++i)
+            plain[i] = i;
+    }), n);
+
+    std::mt19937_64 random(5);
+    std::vector<std::size_t> keys(versions * changes_per_version);
+    for (std::size_t& key : keys)
+        key = random() % n;
+
+    std::vector<persistent_map<std::size_t, long>> history;
+    bench::report("persistent_map versions", bench::seconds([&] {
+        for (std::size_t v = 0; v < versions; ++v) {
+            for (std::size_t c = 0; c < changes_per_version; ++c)
+                map.insert_or_assign(keys[v * changes_per_version + c], v);
+            history.push_back(map);
+        }
+    }), versions);
+
+    std::vector<std::unordered_map<std::size_t, long>> plain_history;
+    bench::report("std::unordered_map copy per version", bench::seconds([&] {
+        for (std::size_t v = 0; v < versions; ++v) {
+            for (std::size_t c = 0; c < changes_per_version; ++c)
+                plain[keys[v * changes_per_version + c]] = v;
+            plain_history.push_back(plain);
+        }
+    }), versions);
+
+    long sum = 0;
+    bench::report("persistent_map find", bench::seconds([&] {
+        for (std::size_t key : keys)
+            sum += *history[key % versions].find(key);
+    }), keys.size());
+    bench::report("std::unordered_map find", bench::seconds([&] {
+        for (std::size_t key : keys)
+            sum += plain_history[key % versions].find(key)->second;
+    }), keys.size());
+    bench::do_not_optimize(sum);
+    return 0;
+}
@@ -0,0 +1,78 @@
+// persistent_vector: push_back, update with and without live snapshots,
+// and the cost of taking a snapshot vs copying an std::vector.
+// usage: persistent_vector_bench [elements]   (default 10^6)
+
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "persistent_vector.h"
+
+using namespace smart_ptr;
+
+int main(int argc, char** argv) {
+    std::size_t n = bench::size_arg(argc, argv, 1000000);
+    const std::size_t snapshots = 100;
+    std::cout << "elements: " << n << std::endl;
+
+    std::vector<long> plain;
+    bench::report("std::vector push_back", bench::seconds([&] {
+        for (std::size_t i = 0; i < n; ++i)
+            plain.push_back(i);
+    }), n);
+
+    persistent_vector<long> v;
+    bench::report("persistent_vector push_back", bench::seconds([&] {
+        for (std::size_t i = 0; i < n; ++i)
+            v.push_back(i);
+    }), n);
+
+    std::mt19937_64 random(3);
+    std::vector<std::size_t> indices(n);
+    for (std::size_t& i : indices)
+        i = random() % n;
+
+    bench::report("persistent_vector set (in place)", bench::seconds([&] {
+        for (std::size_t i : indices)
+            v.set(i, i);
+    }), n);
+
+    // a snapshot after every n / snapshots changes: the path is copied
+    // once per snapshot, then changed in place
+    std::vector<persistent_vector<long>> history;
+    bench::report("persistent_vector set + snapshots", bench::seconds([&] {
+        for (std::size_t k = 0; k < n; ++k) {
+            if (k % (n / snapshots) == 0)
+                history.push_back(v);
+            v.set(indices[k], k);
+        }
+    }), n);
+    history.clear();
+
+    std::vector<std::vector<long>> plain_history;
+    bench::report("std::vector set + copies", bench::seconds([&] {
+        for (std::size_t k = 0; k < n; ++k) {
+            if (k % (n / snapshots) == 0)
+                plain_history.push_back(plain);
+            plain[indices[k]] = k;
+        }
+    }), n);
+    plain_history.clear();
+
+    bench::report("persistent_vector snapshot", bench::seconds([&] {
+        for (std::size_t k = 0; k < snapshots; ++k)
+            history.push_back(v);
+    }), snapshots);
+    bench::report("std::vector copy", bench::seconds([&] {
+        for (std::size_t k = 0; k < snapshots; ++k)
+            plain_history.push_back(plain);
+    }), snapshots);
+
+    long sum = 0;
+    bench::report("persistent_vector operator[]", bench::seconds([&] {
+        for (std::size_t i : indices)
+            sum += v[i];
+    }), n);
+    bench::do_not_optimize(sum);
+    return 0;
+}
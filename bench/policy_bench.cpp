@@ -0,0 +1,87 @@
+// Policies of linked_ptr: the cost of copying and releasing owners
+// with each threading and checking policy.
+//
+// The codegen_* functions are the reference for
+// scripts/check_default_policy.sh, which compiles them against an older
+// linked_ptr.h and checks that the default policy generates the same
+// instructions. Built with -DCODEGEN_ONLY this file needs nothing
+// newer than the plain linked_ptr<T>.
+// usage: policy_bench [operations]   (default 10^7)
+
+#include <new>
+
+#include "linked_ptr.h"
+
+using namespace smart_ptr;
+
+#define CODEGEN __attribute__((noinline))
+
+extern "C" {
+
+CODEGEN void codegen_copy(const linked_ptr<int>& from, linked_ptr<int>* to) {
+    new (to) linked_ptr<int>(from);
+}
+
+CODEGEN void codegen_destroy(linked_ptr<int>* ptr) {
+    ptr->~linked_ptr<int>();
+}
+
+CODEGEN void codegen_reset(linked_ptr<int>& ptr, int* object) {
+    ptr.reset(object);
+}
+
+CODEGEN void codegen_assign(linked_ptr<int>& lhs, const linked_ptr<int>& rhs) {
+    lhs = rhs;
+}
+
+CODEGEN void codegen_swap(linked_ptr<int>& lhs, linked_ptr<int>& rhs) {
+    lhs.swap(rhs);
+}
+
+CODEGEN bool codegen_unique(const linked_ptr<int>& ptr) {
+    return ptr.unique();
+}
+
+} // extern "C"
+
+#ifndef CODEGEN_ONLY
+
+#include <vector>
+
+#include "bench.h"
+
+namespace {
+
+template <typename Ptr>
+void run(const std::string& name, std::size_t operations) {
+    Ptr source(new int(1));
+    // a constant, the ring stores may alias the vector as far as the
+    // compiler knows and its size would be divided by every time
+    const std::size_t slots = 64;
+    std::vector<Ptr> copies(slots);
+    bench::report(name, bench::seconds([&] {
+        for (std::size_t i = 0; i < operations; ++i) {
+            Ptr& slot = copies[i % slots];
+            slot = source;
+            if (i % 2 == 0)
+                slot.reset();
+        }
+    }), operations);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t operations = bench::size_arg(argc, argv, 10000000);
+    std::cout << "operations: " << operations << std::endl;
+
+    run<linked_ptr<int>>("linked_ptr<int>", operations);
+    run<linked_ptr<int, linked_ptr_policy<default_deleter, single_threaded, no_checking>>>(
+            "no_checking", operations);
+    run<linked_ptr<int, linked_ptr_policy<default_deleter, single_threaded, abort_checking>>>(
+            "abort_checking", operations);
+    run<linked_ptr<int, linked_ptr_policy<default_deleter, global_lock>>>("global_lock", operations);
+    return 0;
+}
+
+#endif
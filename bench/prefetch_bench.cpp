@@ -0,0 +1,57 @@
+// Copying and resetting arrays of owners whose ring neighbours are
+// scattered over a large pool: a plain loop vs copy_n / reset_n,
+// which prefetch the neighbours a few elements ahead.
+// usage: prefetch_bench [owners]   (default 8 * 10^6)
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "linked_ptr.h"
+
+using namespace smart_ptr;
+
+namespace {
+
+// rings of 64 owners in random places of the pool
+std::vector<linked_ptr<int>> make_pool(std::size_t size) {
+    std::vector<linked_ptr<int>> objects(std::max<std::size_t>(size / 64, 1));
+    for (std::size_t i = 0; i < objects.size(); ++i)
+        objects[i].reset(new int(int(i)));
+    std::vector<std::size_t> order(size);
+    for (std::size_t i = 0; i < size; ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(1));
+
+    std::vector<linked_ptr<int>> pool(size);
+    for (std::size_t i = 0; i < size; ++i)
+        pool[order[i]] = objects[i % objects.size()];
+    return pool;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t size = bench::size_arg(argc, argv, 8000000);
+    std::cout << "owners: " << size << std::endl;
+    std::vector<linked_ptr<int>> pool = make_pool(size);
+    std::vector<linked_ptr<int>> copies(size);
+
+    bench::report("dst[i] = src[i]", bench::seconds([&] {
+        for (std::size_t i = 0; i < size; ++i)
+            copies[i] = pool[i];
+    }), size);
+    bench::report("reset() in a loop", bench::seconds([&] {
+        for (auto& c : copies)
+            c.reset();
+    }), size);
+
+    bench::report("copy_n", bench::seconds([&] {
+        copy_n(pool.data(), size, copies.data());
+    }), size);
+    bench::report("reset_n", bench::seconds([&] {
+        reset_n(copies.data(), size);
+    }), size);
+    return 0;
+}
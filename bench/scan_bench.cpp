@@ -0,0 +1,77 @@
+// Scanning an array of owners: std::find with operator== vs
+// find_pointee, std::count_if vs count_non_null, std::stable_partition
+// vs partition_null, for an array which fits in L1 and a large one.
+// scan_bench_avx2 is the same built with -mavx2.
+// usage: scan_bench [elements]   (default 10^6)
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "linked_ptr_scan.h"
+
+using namespace smart_ptr;
+
+namespace {
+
+struct task {
+    int id;
+};
+
+void run(std::size_t size, std::size_t total) {
+    // every fourth owner is empty
+    std::vector<linked_ptr<task>> owners(size);
+    for (std::size_t i = 0; i < size; ++i)
+        if (i % 4 != 1)
+            owners[i].reset(new task{static_cast<int>(i)});
+    const std::size_t rounds = std::max<std::size_t>(1, total / size);
+    const linked_ptr<task>* first = owners.data();
+    const linked_ptr<task>* last = first + size;
+    // found at the end, so both scan everything
+    task* target = owners[size - 1].get();
+    std::string suffix = ", " + std::to_string(size) + " elements";
+
+    std::size_t sum = 0;
+    bench::report("std::find" + suffix, bench::seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r)
+            sum += std::find(owners.begin(), owners.end(), target) - owners.begin();
+    }), rounds * size);
+    bench::report("find_pointee" + suffix, bench::seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r)
+            sum += find_pointee(first, last, target) - first;
+    }), rounds * size);
+
+    bench::report("std::count_if" + suffix, bench::seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r)
+            sum += std::count_if(owners.begin(), owners.end(), [](const linked_ptr<task>& p) {
+                return static_cast<bool>(p);
+            });
+    }), rounds * size);
+    bench::report("count_non_null" + suffix, bench::seconds([&] {
+        for (std::size_t r = 0; r < rounds; ++r)
+            sum += count_non_null(first, last);
+    }), rounds * size);
+
+    // once each, the array is partitioned afterwards
+    std::vector<linked_ptr<task>> copy(owners);
+    bench::report("std::stable_partition" + suffix, bench::seconds([&] {
+        sum += std::stable_partition(copy.begin(), copy.end(), [](const linked_ptr<task>& p) {
+            return static_cast<bool>(p);
+        }) - copy.begin();
+    }), size);
+    bench::report("partition_null" + suffix, bench::seconds([&] {
+        sum += partition_null(owners.data(), owners.data() + size) - owners.data();
+    }), size);
+    bench::do_not_optimize(sum);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t size = bench::size_arg(argc, argv, 1000000);
+    std::cout << "vector lanes: " << details::scan_lanes << std::endl;
+    run(1024, 100 * size);
+    run(size, 100 * size);
+    return 0;
+}
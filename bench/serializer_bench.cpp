@@ -0,0 +1,134 @@
+// Writing a linked_ptr graph with shared nodes: ring stamping in
+// linked_ptr_writer vs an std::unordered_map<void*, id> of written objects.
+// usage: serializer_bench [nodes]   (default 10^6)
+
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#include "bench.h"
+#include "linked_ptr.h"
+#include "linked_ptr_serializer.h"
+
+using namespace smart_ptr;
+
+namespace {
+
+struct node {
+    node(long value, const linked_ptr<node>& left, const linked_ptr<node>& right, const linked_ptr<node>& tag)
+            : value(value), left(left), right(right), tag(tag) {}
+
+    long value;
+    linked_ptr<node> left;
+    linked_ptr<node> right;
+    linked_ptr<node> tag;
+};
+
+// node i has children 2i + 1 and 2i + 2 and one of n / 8 shared tags
+linked_ptr<node> build(std::size_t n) {
+    linked_ptr<node> none;
+    std::size_t tag_count = n / 8 + 1;
+    std::vector<linked_ptr<node>> tags(tag_count);
+    for (std::size_t i = 0; i < tag_count; ++i)
+        tags[i].reset(new node(-static_cast<long>(i), none, none, none));
+
+    std::vector<linked_ptr<node>> nodes(n);
+    for (std::size_t i = n; i-- > 0;) {
+        std::size_t l = 2 * i + 1, r = 2 * i + 2;
+        nodes[i].reset(new node(i, l < n ? nodes[l] : none, r < n ? nodes[r] : none,
+                                tags[(i * 7919) % tag_count]));
+    }
+    return nodes[0];
+}
+
+void write_node(linked_ptr_writer& writer, const node& n) {
+    writer.write_value(n.value);
+    writer.write(n.left, write_node);
+    writer.write(n.right, write_node);
+    writer.write(n.tag, write_node);
+}
+
+node* read_node(linked_ptr_reader& reader) {
+    long value = reader.read_value<long>();
+    linked_ptr<node> left = reader.read<node>(read_node);
+    linked_ptr<node> right = reader.read<node>(read_node);
+    linked_ptr<node> tag = reader.read<node>(read_node);
+    return new node(value, left, right, tag);
+}
+
+// the same format, sharing detected with a hash map
+class map_writer {
+public:
+    explicit map_writer(std::ostream& out) : _writer(out) {}
+
+    void write(const linked_ptr<node>& ptr) {
+        if (!ptr) {
+            _writer.write_size(details::null_tag);
+            return;
+        }
+        auto inserted = _ids.emplace(ptr.get(), _ids.size());
+        if (!inserted.second) {
+            _writer.write_size(details::reference_tag + inserted.first->second);
+            return;
+        }
+        _writer.write_size(details::shared_tag);
+        _writer.write_value(ptr->value);
+        write(ptr->left);
+        write(ptr->right);
+        write(ptr->tag);
+    }
+
+private:
+    linked_ptr_writer _writer;
+    std::unordered_map<const void*, std::size_t> _ids;
+};
+
+// counts and drops everything written
+struct null_buffer : std::streambuf {
+    std::streamsize xsputn(const char*, std::streamsize n) override {
+        size += n;
+        return n;
+    }
+
+    int overflow(int c) override {
+        ++size;
+        return c;
+    }
+
+    std::size_t size = 0;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t n = bench::size_arg(argc, argv, 1000000);
+    linked_ptr<node> root = build(n);
+    std::cout << "nodes: " << n << ", owners: " << 3 * n << std::endl;
+
+    null_buffer ring_buffer;
+    std::ostream ring_out(&ring_buffer);
+    bench::report("linked_ptr_writer (ring stamps)", bench::seconds([&] {
+        linked_ptr_writer writer(ring_out);
+        writer.write(root, write_node);
+    }), 3 * n);
+
+    null_buffer map_buffer;
+    std::ostream map_out(&map_buffer);
+    bench::report("unordered_map<void*, id> writer", bench::seconds([&] {
+        map_writer writer(map_out);
+        writer.write(root);
+    }), 3 * n);
+    std::cout << "bytes: " << ring_buffer.size << " vs " << map_buffer.size << std::endl;
+
+    std::stringstream stream;
+    {
+        linked_ptr_writer writer(stream);
+        writer.write(root, write_node);
+    }
+    bench::report("linked_ptr_reader", bench::seconds([&] {
+        linked_ptr_reader reader(stream);
+        linked_ptr<node> loaded = reader.read<node>(read_node);
+        bench::do_not_optimize(loaded.get());
+    }), 3 * n);
+    return 0;
+}
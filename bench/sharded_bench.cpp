@@ -0,0 +1,69 @@
+// One object copied and released on every thread, 1 to 128 threads:
+// sharded_ptr (a ring per thread), linked_ptr with the global_lock
+// policy (one ring) and shared_ptr (one counter).
+// usage: sharded_bench [copies per thread]   (default 10^5)
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "sharded_ptr.h"
+
+using namespace smart_ptr;
+
+namespace {
+
+using locked_ptr = linked_ptr<int, linked_ptr_policy<default_deleter, global_lock>>;
+
+// every thread takes a local owner, then copies it into a few slots
+template <typename Ptr>
+double run(const Ptr& shared, std::size_t threads, std::size_t copies) {
+    std::atomic<std::size_t> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            Ptr local(shared);
+            std::vector<Ptr> slots(8);
+            ++ready;
+            while (!go)
+                std::this_thread::yield();
+            for (std::size_t i = 0; i < copies; ++i) {
+                Ptr& slot = slots[i % slots.size()];
+                slot = local;
+                if (i % 2 == 0)
+                    slot.reset();
+            }
+        });
+    }
+    while (ready != threads)
+        std::this_thread::yield();
+    double seconds = bench::seconds([&] {
+        go = true;
+        for (auto& w : workers)
+            w.join();
+    });
+    return seconds;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t copies = bench::size_arg(argc, argv, 100000);
+    std::cout << "copies per thread: " << copies << ", cores: " << std::thread::hardware_concurrency() << std::endl;
+
+    sharded_ptr<int> sharded(new int(1));
+    locked_ptr locked(new int(1));
+    std::shared_ptr<int> counted(new int(1));
+    for (std::size_t threads = 1; threads <= 128; threads *= 2) {
+        std::string suffix = ", " + std::to_string(threads) + " threads";
+        std::size_t total = copies * threads;
+        bench::report("sharded_ptr" + suffix, run(sharded, threads, copies), total);
+        bench::report("linked_ptr, global_lock" + suffix, run(locked, threads, copies), total);
+        bench::report("shared_ptr" + suffix, run(counted, threads, copies), total);
+    }
+    return 0;
+}
@@ -0,0 +1,147 @@
+// Warm start of a linked_ptr graph: rebuilding it from a flat record
+// file vs mapping a snapshot.
+// usage: snapshot_bench [nodes]   (default 10^6, try 10^7)
+
+#include <cstdio>
+#include <vector>
+
+#include <unistd.h>
+
+#include "bench.h"
+#include "linked_ptr.h"
+#include "linked_ptr_snapshot.h"
+
+using namespace smart_ptr;
+
+namespace {
+
+const std::size_t tag_count = 16;
+
+struct node {
+    node(long value, const linked_ptr<node>& left, const linked_ptr<node>& right, const linked_ptr<node>& tag)
+            : value(value), left(left), right(right), tag(tag) {}
+
+    long value;
+    linked_ptr<node> left;
+    linked_ptr<node> right;
+    linked_ptr<node> tag;
+};
+
+struct snap_node {
+    explicit snap_node(long value) : value(value) {}
+
+    long value;
+    offset_linked_ptr<snap_node> left;
+    offset_linked_ptr<snap_node> right;
+    offset_linked_ptr<snap_node> tag;
+};
+
+struct record {
+    long value;
+    long left;
+    long right;
+    long tag;
+};
+
+// node i has children 2i + 1 and 2i + 2, tags are shared by many nodes
+std::vector<record> make_records(std::size_t n) {
+    std::vector<record> records(n + tag_count);
+    for (std::size_t i = 0; i < n; ++i) {
+        long l = 2 * i + 1, r = 2 * i + 2;
+        records[i] = {static_cast<long>(i), l < static_cast<long>(n) ? l : -1,
+                      r < static_cast<long>(n) ? r : -1, static_cast<long>(n + i % tag_count)};
+    }
+    for (std::size_t i = n; i < n + tag_count; ++i)
+        records[i] = {static_cast<long>(i), -1, -1, -1};
+    return records;
+}
+
+linked_ptr<node> build(const std::vector<record>& records) {
+    std::vector<linked_ptr<node>> nodes(records.size());
+    for (std::size_t i = records.size(); i-- > 0;) {
+        const record& r = records[i];
+        linked_ptr<node> none;
+        nodes[i].reset(new node(r.value, r.left < 0 ? none : nodes[r.left],
+                                r.right < 0 ? none : nodes[r.right], r.tag < 0 ? none : nodes[r.tag]));
+    }
+    return nodes[0];
+}
+
+snap_node* copy_node(snapshot_builder& builder, const node& n) {
+    auto* copy = builder.get_segment().construct<snap_node>(n.value);
+    auto convert = [&builder](const node& child) { return copy_node(builder, child); };
+    builder.assign(copy->left, n.left, convert);
+    builder.assign(copy->right, n.right, convert);
+    builder.assign(copy->tag, n.tag, convert);
+    return copy;
+}
+
+template <typename Node>
+long sum(const Node& n) {
+    long total = n.value + (n.tag ? n.tag->value : 0);
+    if (n.left)
+        total += sum(*n.left);
+    if (n.right)
+        total += sum(*n.right);
+    return total;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t n = bench::size_arg(argc, argv, 1000000);
+    std::vector<record> records = make_records(n);
+
+    char records_path[] = "/tmp/linked_ptr_recordsXXXXXX";
+    char snapshot_path[] = "/tmp/linked_ptr_snapshotXXXXXX";
+    close(mkstemp(records_path));
+    close(mkstemp(snapshot_path));
+
+    std::FILE* file = std::fopen(records_path, "wb");
+    std::fwrite(records.data(), sizeof(record), records.size(), file);
+    std::fclose(file);
+
+    // make the snapshot
+    {
+        linked_ptr<node> root = build(records);
+        std::vector<char> memory(64 + (n + tag_count) * (sizeof(snap_node) + alignof(std::max_align_t)));
+        segment seg = segment::create(memory.data(), memory.size());
+        snapshot_builder builder(seg);
+        auto* snap_root = seg.construct<offset_linked_ptr<snap_node>>();
+        double t = bench::seconds([&] {
+            builder.assign(*snap_root, root, [&builder](const node& r) { return copy_node(builder, r); });
+        });
+        seg.set_root(snap_root);
+        builder.finish();
+        save_snapshot(seg, snapshot_path);
+        bench::report("build snapshot", t, n);
+    }
+
+    std::cout << "nodes: " << n << std::endl;
+
+    long expected = 0;
+    bench::report("rebuild from records", bench::seconds([&] {
+        std::vector<record> loaded(n + tag_count);
+        std::FILE* in = std::fopen(records_path, "rb");
+        std::size_t read = std::fread(loaded.data(), sizeof(record), loaded.size(), in);
+        std::fclose(in);
+        bench::do_not_optimize(read);
+        linked_ptr<node> root = build(loaded);
+        expected = sum(*root);
+    }), n);
+
+    bench::report("map snapshot", bench::seconds([&] {
+        mapped_snapshot snapshot(snapshot_path);
+        bench::do_not_optimize(snapshot.root<offset_linked_ptr<snap_node>>());
+    }));
+
+    long actual = 0;
+    bench::report("map snapshot + full traversal", bench::seconds([&] {
+        mapped_snapshot snapshot(snapshot_path);
+        actual = sum(**snapshot.root<offset_linked_ptr<snap_node>>());
+    }), n);
+
+    unlink(records_path);
+    unlink(snapshot_path);
+    return actual == expected ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+// Shutdown with many owners: every object is held by a few tables of
+// handles, each in its own order, so the ring neighbours of an owner are
+// scattered. Releasing the tables one by one relinks the rings on every
+// reset; linked_ptr_arena::teardown empties the owners in place and
+// deletes each object once.
+// usage: teardown_bench [objects]   (default 10^6, 4 owners per object;
+// 2.5 * 10^7 objects make a 10^8 owner graph)
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "linked_ptr_arena.h"
+
+using namespace smart_ptr;
+
+namespace {
+
+const std::size_t tables = 4;
+
+struct object {
+    long payload[4] = {};
+};
+
+std::vector<std::vector<linked_ptr<object>>> make_tables(std::size_t size) {
+    std::vector<std::vector<linked_ptr<object>>> result(tables, std::vector<linked_ptr<object>>(size));
+    std::vector<std::size_t> order(size);
+    for (std::size_t i = 0; i < size; ++i)
+        order[i] = i;
+    for (auto& table : result) {
+        std::shuffle(order.begin(), order.end(), std::mt19937(unsigned(&table - result.data())));
+        for (std::size_t i = 0; i < size; ++i) {
+            if (&table == result.data())
+                table[i].reset(new object());
+            else
+                table[order[i]] = result[0][i];
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t size = bench::size_arg(argc, argv, 1000000);
+    std::cout << "objects: " << size << ", owners: " << tables * size << std::endl;
+
+    {
+        auto t = make_tables(size);
+        bench::report("tables released one by one", bench::seconds([&] {
+            for (auto& table : t)
+                std::vector<linked_ptr<object>>().swap(table);
+        }), tables * size);
+    }
+
+    auto t = make_tables(size);
+    linked_ptr_arena arena;
+    bench::report("adopting the owners", bench::seconds([&] {
+        for (auto& table : t)
+            arena.adopt(table.data(), table.data() + table.size());
+    }), tables * size);
+    bench::report("linked_ptr_arena::teardown", bench::seconds([&] {
+        arena.teardown();
+        for (auto& table : t)
+            std::vector<linked_ptr<object>>().swap(table);
+    }), tables * size);
+    return 0;
+}
@@ -0,0 +1,70 @@
+#ifndef COW_H
+#define COW_H
+
+#include <utility>
+
+#include "linked_ptr.h"
+
+namespace smart_ptr {
+
+/// Copy-on-write value: copies share one object, the first write
+/// through a copy that is not the only owner clones it
+/// (linked_ptr::unique() makes the check O(1) without a counter).
+template <typename T>
+class cow {
+public:
+    cow() : _value(new T()) {}
+
+    explicit cow(const T& value) : _value(new T(value)) {}
+
+    explicit cow(T&& value) : _value(new T(std::move(value))) {}
+
+    // Info
+
+    const T& get() const noexcept {
+        return *_value;
+    }
+
+    const T& operator*() const noexcept {
+        return *_value;
+    }
+
+    const T* operator->() const noexcept {
+        return _value.get();
+    }
+
+    /// Whether other copies share the value
+    bool shared() const noexcept {
+        return !_value.unique();
+    }
+
+    // Modification
+
+    /// Value for writing, cloned first if shared
+    T& write() {
+        if (!_value.unique())
+            _value.reset(new T(*_value));
+        return *_value;
+    }
+
+    void swap(cow& other) noexcept {
+        _value.swap(other._value);
+    }
+
+private:
+    linked_ptr<T> _value;
+};
+
+template <typename T>
+bool operator==(const cow<T>& lhs, const cow<T>& rhs) {
+    return &*lhs == &*rhs || *lhs == *rhs;
+}
+
+template <typename T>
+bool operator!=(const cow<T>& lhs, const cow<T>& rhs) {
+    return !(lhs == rhs);
+}
+
+} // namespace smart_ptr
+
+#endif // COW_H
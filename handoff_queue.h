@@ -0,0 +1,103 @@
+#ifndef HANDOFF_QUEUE_H
+#define HANDOFF_QUEUE_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include "linked_ptr.h"
+
+namespace smart_ptr {
+
+/// Moves linked_ptrs from one thread to another. The rings are not
+/// thread-safe, so an owner is handed off only when it is alone in its
+/// ring: nothing stays behind on the sending thread, and the move into
+/// and out of a slot swaps the pointer without writing any ring.
+///
+/// One producer and one consumer thread. Each side keeps a copy of the
+/// other side's index and reads the shared one only when the copy says
+/// the queue is full (or empty), so the fast path is a plain load of
+/// its own index and a release store: no read-modify-write, no fence.
+template <typename T, typename Policy = linked_ptr_policy<> >
+class handoff_queue {
+public:
+    using pointer = linked_ptr<T, Policy>;
+
+    /// capacity: rounded up to a power of two
+    explicit handoff_queue(std::size_t capacity = 1024) : _mask(1) {
+        while (_mask < capacity)
+            _mask *= 2;
+        _slots.resize(_mask);
+        _mask -= 1;
+    }
+
+    handoff_queue(const handoff_queue&) = delete;
+    handoff_queue& operator=(const handoff_queue&) = delete;
+
+    /// Producer thread. Moves ptr into the queue and leaves it empty,
+    /// returns false and keeps ptr if the queue is full.
+    bool try_push(pointer& ptr) noexcept {
+        check_alone(ptr);
+        std::size_t head = _head.load(std::memory_order_relaxed);
+        if (head - _cached_tail > _mask) {
+            _cached_tail = _tail.load(std::memory_order_acquire);
+            if (head - _cached_tail > _mask)
+                return false;
+        }
+        _slots[head & _mask].swap(ptr);
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer thread. Moves the oldest pointer into out, whose previous
+    /// object is released here; returns false if the queue is empty.
+    bool try_pop(pointer& out) noexcept {
+        std::size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _cached_head) {
+            _cached_head = _head.load(std::memory_order_acquire);
+            if (tail == _cached_head)
+                return false;
+        }
+        // released before the swap, or it would go back to the producer
+        out.reset();
+        _slots[tail & _mask].swap(out);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer thread, a hint for the producer
+    bool empty() const noexcept {
+        return _tail.load(std::memory_order_relaxed) == _head.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity() const noexcept {
+        return _mask + 1;
+    }
+
+private:
+    // the whole ring goes to the other thread or the handoff is a race
+    static void check_alone(const pointer& ptr) noexcept {
+#ifdef LINKED_PTR_DEBUG
+        if (!ptr.unique())
+            details::ring_failure("handing off an owner which is not alone in its ring", ptr.get());
+#endif
+        assert(ptr.unique());
+        (void) ptr;
+    }
+
+    std::vector<pointer> _slots;
+    std::size_t _mask;
+
+    // written by the producer
+    alignas(64) std::atomic<std::size_t> _head{0};
+    std::size_t _cached_tail = 0;
+
+    // written by the consumer
+    alignas(64) std::atomic<std::size_t> _tail{0};
+    std::size_t _cached_head = 0;
+};
+
+} // namespace smart_ptr
+
+#endif // HANDOFF_QUEUE_H
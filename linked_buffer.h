@@ -0,0 +1,155 @@
+#ifndef LINKED_BUFFER_H
+#define LINKED_BUFFER_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#include "linked_ptr.h"
+
+namespace smart_ptr {
+
+namespace details {
+
+    // contiguous bytes shared by buffers and slices,
+    // the last owner deletes it and the subclass frees the bytes
+    class buffer_storage {
+    public:
+        buffer_storage(const buffer_storage&) = delete;
+        buffer_storage& operator=(const buffer_storage&) = delete;
+
+        virtual ~buffer_storage() = default;
+
+        char* data() const noexcept {
+            return _data;
+        }
+
+        std::size_t size() const noexcept {
+            return _size;
+        }
+
+    protected:
+        buffer_storage(char* data, std::size_t size) noexcept : _data(data), _size(size) {}
+
+    private:
+        char* _data;
+        std::size_t _size;
+    };
+
+    class heap_storage : public buffer_storage {
+    public:
+        explicit heap_storage(std::size_t size) : buffer_storage(new char[size], size) {}
+
+        ~heap_storage() override {
+            delete[] data();
+        }
+    };
+
+} // namespace details
+
+/// Read-only view of a part of a buffer which shares the ownership of
+/// the whole buffer: it joins the ring of the storage, so the bytes stay
+/// alive as long as any slice of them does, without copying.
+class buffer_slice {
+public:
+    buffer_slice() noexcept = default;
+
+    buffer_slice(const linked_ptr<details::buffer_storage>& owner, const char* data, std::size_t size) noexcept
+            : _owner(owner), _data(data), _size(size) {
+        assert(!owner ? size == 0 : data >= owner->data() && data + size <= owner->data() + owner->size());
+    }
+
+    // Info
+
+    const char* data() const noexcept {
+        return _data;
+    }
+
+    std::size_t size() const noexcept {
+        return _size;
+    }
+
+    bool empty() const noexcept {
+        return _size == 0;
+    }
+
+    const char* begin() const noexcept {
+        return _data;
+    }
+
+    const char* end() const noexcept {
+        return _data + _size;
+    }
+
+    char operator[](std::size_t i) const noexcept {
+        return _data[i];
+    }
+
+    /// Part of this slice, sharing the same storage
+    buffer_slice slice(std::size_t offset, std::size_t size = std::string::npos) const noexcept {
+        offset = std::min(offset, _size);
+        return buffer_slice(_owner, _data + offset, std::min(size, _size - offset));
+    }
+
+    std::string str() const {
+        return std::string(_data, _size);
+    }
+
+    /// Whether this slice keeps the storage alive alone
+    bool unique() const noexcept {
+        return _owner.unique();
+    }
+
+private:
+    linked_ptr<details::buffer_storage> _owner;
+    const char* _data = nullptr;
+    std::size_t _size = 0;
+};
+
+// an empty slice has no data, which memcmp must not be given
+inline bool operator==(const buffer_slice& lhs, const buffer_slice& rhs) noexcept {
+    return lhs.size() == rhs.size() && (lhs.empty() || std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0);
+}
+
+inline bool operator!=(const buffer_slice& lhs, const buffer_slice& rhs) noexcept {
+    return !(lhs == rhs);
+}
+
+inline bool operator==(const buffer_slice& lhs, const std::string& rhs) noexcept {
+    return lhs.size() == rhs.size() && (lhs.empty() || std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0);
+}
+
+inline bool operator!=(const buffer_slice& lhs, const std::string& rhs) noexcept {
+    return !(lhs == rhs);
+}
+
+/// Writable block of bytes whose parts can be handed out as slices
+class linked_buffer {
+public:
+    linked_buffer() noexcept = default;
+
+    explicit linked_buffer(std::size_t size) : _storage(new details::heap_storage(size)) {}
+
+    explicit linked_buffer(details::buffer_storage* storage) : _storage(storage) {}
+
+    char* data() const noexcept {
+        return _storage ? _storage->data() : nullptr;
+    }
+
+    std::size_t size() const noexcept {
+        return _storage ? _storage->size() : 0;
+    }
+
+    buffer_slice slice(std::size_t offset = 0, std::size_t size = std::string::npos) const noexcept {
+        return buffer_slice(_storage, data(), this->size()).slice(offset, size);
+    }
+
+private:
+    linked_ptr<details::buffer_storage> _storage;
+};
+
+} // namespace smart_ptr
+
+#endif // LINKED_BUFFER_H
@@ -0,0 +1,203 @@
+#ifndef LINKED_CACHE_H
+#define LINKED_CACHE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "linked_ptr.h"
+
+namespace smart_ptr {
+
+template <typename V>
+struct sizeof_size {
+    std::size_t operator()(const V&) const noexcept {
+        return sizeof(V);
+    }
+};
+
+/// Cache of linked_ptr values limited by the size of the values.
+/// Keys are spread over shards, each evicting with the CLOCK algorithm
+/// (an approximation of LRU): an entry used since the hand passed it
+/// gets a second chance. An entry is evicted only while the cache is
+/// its sole owner (linked_ptr::unique()), values handed out by get()
+/// stay cached until they are released.
+/// Like linked_ptr itself, the cache is not thread-safe.
+template <typename K, typename V, typename Hash = std::hash<K>, typename Size = sizeof_size<V> >
+class linked_cache {
+public:
+    /// There are at most as many shards as units of capacity, the
+    /// capacity is split among them evenly
+    explicit linked_cache(std::size_t capacity, std::size_t shard_count = 16,
+                          const Hash& hash = Hash(), const Size& size = Size())
+            : _shards(std::max<std::size_t>(1, std::min(shard_count, capacity))),
+              _capacity(capacity), _hash(hash), _size(size) {
+        for (std::size_t i = 0; i < _shards.size(); ++i)
+            _shards[i].capacity = capacity / _shards.size() + (i < capacity % _shards.size());
+    }
+
+    /// Value for the key or nullptr
+    linked_ptr<V> get(const K& key) {
+        shard& s = shard_of(key);
+        auto it = s.index.find(key);
+        if (it == s.index.end())
+            return linked_ptr<V>();
+        entry& e = s.entries[it->second];
+        e.referenced = true;
+        return e.value;
+    }
+
+    bool contains(const K& key) const {
+        const shard& s = shard_of(key);
+        return s.index.find(key) != s.index.end();
+    }
+
+    /// Inserts or replaces the value, then evicts down to the capacity
+    void put(const K& key, const linked_ptr<V>& value) {
+        shard& s = shard_of(key);
+        std::size_t bytes = value ? _size(*value) : 0;
+        auto it = s.index.find(key);
+        if (it != s.index.end()) {
+            entry& e = s.entries[it->second];
+            s.bytes -= e.bytes;
+            e.value = value;
+            e.bytes = bytes;
+            e.referenced = true;
+            // the old value may have been the one to evict
+            s.idle = 0;
+        } else {
+            std::size_t slot;
+            if (!s.free.empty()) {
+                slot = s.free.back();
+                s.free.pop_back();
+            } else {
+                slot = s.entries.size();
+                s.entries.emplace_back();
+            }
+            entry& e = s.entries[slot];
+            e.key = key;
+            e.value = value;
+            e.bytes = bytes;
+            // a new entry has to be used again to get a second chance
+            e.referenced = false;
+            e.used = true;
+            s.index.emplace(key, slot);
+        }
+        s.bytes += bytes;
+        evict(s);
+    }
+
+    bool erase(const K& key) {
+        shard& s = shard_of(key);
+        auto it = s.index.find(key);
+        if (it == s.index.end())
+            return false;
+        release(s, it->second);
+        return true;
+    }
+
+    /// Evicts down to the capacity in every shard, including the ones
+    /// whose entries were all shared at the last scan
+    void shrink() {
+        for (shard& s : _shards) {
+            s.idle = 0;
+            evict(s);
+        }
+    }
+
+    std::size_t size() const noexcept {
+        std::size_t result = 0;
+        for (const shard& s : _shards)
+            result += s.index.size();
+        return result;
+    }
+
+    /// Total size of the cached values
+    std::size_t bytes() const noexcept {
+        std::size_t result = 0;
+        for (const shard& s : _shards)
+            result += s.bytes;
+        return result;
+    }
+
+    std::size_t capacity() const noexcept {
+        return _capacity;
+    }
+
+private:
+    struct entry {
+        K key;
+        linked_ptr<V> value;
+        std::size_t bytes = 0;
+        bool referenced = false;
+        bool used = false;
+    };
+
+    struct shard {
+        std::unordered_map<K, std::size_t, Hash> index;
+        std::vector<entry> entries;
+        std::vector<std::size_t> free;
+        std::size_t hand = 0;
+        std::size_t bytes = 0;
+        std::size_t capacity = 0;
+        // puts left without a scan, since the last one freed too little
+        std::size_t idle = 0;
+    };
+
+    shard& shard_of(const K& key) {
+        return _shards[_hash(key) % _shards.size()];
+    }
+
+    const shard& shard_of(const K& key) const {
+        return _shards[_hash(key) % _shards.size()];
+    }
+
+    void release(shard& s, std::size_t slot) {
+        entry& e = s.entries[slot];
+        s.index.erase(e.key);
+        s.bytes -= e.bytes;
+        e.value.reset();
+        e.bytes = 0;
+        e.used = false;
+        s.free.push_back(slot);
+        s.idle = 0;
+    }
+
+    // two turns of the hand: the first one may only clear the bits;
+    // if everything is still shared outside, the shard stays over capacity
+    // and the next puts skip the scan, until an entry is released or
+    // replaced, or as many entries were added as the turn looked at
+    void evict(shard& s) {
+        if (s.idle > 0) {
+            --s.idle;
+            return;
+        }
+        std::size_t steps = 2 * s.entries.size();
+        while (s.bytes > s.capacity && steps-- > 0) {
+            std::size_t slot = s.hand;
+            s.hand = (s.hand + 1) % s.entries.size();
+            entry& e = s.entries[slot];
+            if (!e.used || !e.value.unique())
+                continue;
+            if (e.referenced) {
+                e.referenced = false;
+                continue;
+            }
+            release(s, slot);
+        }
+        if (s.bytes > s.capacity)
+            s.idle = s.entries.size();
+    }
+
+    std::vector<shard> _shards;
+    std::size_t _capacity;
+    Hash _hash;
+    Size _size;
+};
+
+} // namespace smart_ptr
+
+#endif // LINKED_CACHE_H
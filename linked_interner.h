@@ -0,0 +1,133 @@
+#ifndef LINKED_INTERNER_H
+#define LINKED_INTERNER_H
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "linked_ptr.h"
+
+namespace smart_ptr {
+
+/// Pool of immutable values: equal values share one object.
+/// An entry is reclaimed once the pool is its only owner
+/// (linked_ptr::unique()). Reclaiming is incremental: every intern()
+/// looks at sweep_step slots, so no call pays for a full sweep.
+/// Open addressing with linear probing, reclaimed slots become
+/// tombstones until the next rehash.
+template <typename T, typename Hash = std::hash<T>, typename Equal = std::equal_to<T> >
+class linked_interner {
+public:
+    explicit linked_interner(std::size_t sweep_step = 8, const Hash& hash = Hash(), const Equal& equal = Equal())
+            : _slots(16), _sweep_step(sweep_step), _hash(hash), _equal(equal) {}
+
+    /// Shared object equal to value
+    linked_ptr<const T> intern(const T& value) {
+        sweep(_sweep_step);
+
+        std::size_t hash = _hash(value);
+        std::size_t mask = _slots.size() - 1;
+        std::size_t free = _slots.size();
+        for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+            slot& s = _slots[i];
+            if (s.tombstone) {
+                if (free == _slots.size())
+                    free = i;
+            } else if (!s.value) {
+                if (free == _slots.size())
+                    free = i;
+                break;
+            } else if (s.hash == hash && _equal(*s.value, value)) {
+                return s.value;
+            }
+        }
+
+        slot& s = _slots[free];
+        if (s.tombstone) {
+            s.tombstone = false;
+            --_tombstones;
+        }
+        s.value.reset(new T(value));
+        s.hash = hash;
+        ++_size;
+        linked_ptr<const T> result(s.value);
+        if ((_size + _tombstones) * 4 > _slots.size() * 3)
+            rehash();
+        return result;
+    }
+
+    /// Looks at the next steps slots, returns the number of reclaimed entries
+    std::size_t sweep(std::size_t steps) {
+        std::size_t reclaimed = 0;
+        std::size_t mask = _slots.size() - 1;
+        for (; steps > 0; --steps, _cursor = (_cursor + 1) & mask) {
+            slot& s = _slots[_cursor];
+            if (s.value && s.value.unique()) {
+                s.value.reset();
+                s.tombstone = true;
+                --_size;
+                ++_tombstones;
+                ++reclaimed;
+            }
+        }
+        return reclaimed;
+    }
+
+    /// Reclaims every entry nobody else owns
+    std::size_t sweep_all() {
+        return sweep(_slots.size());
+    }
+
+    /// Number of entries (including not yet reclaimed ones)
+    std::size_t size() const noexcept {
+        return _size;
+    }
+
+private:
+    struct slot {
+        linked_ptr<const T> value;
+        std::size_t hash = 0;
+        bool tombstone = false;
+    };
+
+    // drops tombstones and unowned entries, grows if still crowded
+    void rehash() {
+        std::vector<slot> old;
+        old.swap(_slots);
+        std::size_t live = 0;
+        for (slot& s : old)
+            live += s.value && !s.value.unique();
+        std::size_t capacity = old.size();
+        while (live * 2 > capacity)
+            capacity *= 2;
+
+        _slots.clear();
+        _slots.resize(capacity);
+        _size = 0;
+        _tombstones = 0;
+        _cursor = 0;
+        std::size_t mask = capacity - 1;
+        for (slot& s : old) {
+            if (!s.value || s.value.unique())
+                continue;
+            std::size_t i = s.hash & mask;
+            while (_slots[i].value)
+                i = (i + 1) & mask;
+            _slots[i].value.swap(s.value);
+            _slots[i].hash = s.hash;
+            ++_size;
+        }
+    }
+
+    std::vector<slot> _slots;
+    std::size_t _size = 0;
+    std::size_t _tombstones = 0;
+    std::size_t _cursor = 0;
+    std::size_t _sweep_step;
+    Hash _hash;
+    Equal _equal;
+};
+
+} // namespace smart_ptr
+
+#endif // LINKED_INTERNER_H
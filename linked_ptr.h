@@ -2,76 +2,470 @@
 #define LINKED_PTR_H
 
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <mutex>
+#include <type_traits>
 #include <utility>
 #include <functional>
 
+#ifdef LINKED_PTR_TRACE
+#include <sys/sdt.h>
+#include <typeinfo>
+
+// USDT probes in the "linked_ptr" provider, arguments are the hash of
+// the type name, the object, whether the ring was unique and the
+// mangled type name. List them with `bpftrace -l 'usdt:BINARY:linked_ptr:*'`.
+#define LINKED_PTR_PROBE(probe, T, ptr, unique) \
+    DTRACE_PROBE4(linked_ptr, probe, typeid(T).hash_code(), static_cast<const void*>(ptr), \
+                  static_cast<int>(unique), typeid(T).name())
+#else
+#define LINKED_PTR_PROBE(probe, T, ptr, unique) ((void) 0)
+#endif
+
+#ifdef LINKED_PTR_STATS
+#include "linked_ptr_stats.h"
+#endif
+
+#ifdef LINKED_PTR_DEBUG
+#include <cstdio>
+#include <typeinfo>
+#include <unordered_map>
+#endif
+
+#ifdef LINKED_PTR_THREAD_CHECK
+#include <atomic>
+#include <cstdio>
+#if defined(__has_include)
+#if __has_include(<execinfo.h>)
+#include <execinfo.h>
+#define LINKED_PTR_BACKTRACE
+#endif
+#endif
+#endif
+
 namespace smart_ptr {
 
-template <typename T>
+template <typename T, typename Policy>
 class linked_ptr;
 
 namespace details {
 
+    // the same object is seen through linked_ptrs to different bases
+    template <typename T>
+    const void* object_address(T* ptr, std::true_type /* polymorphic */) noexcept {
+        return dynamic_cast<const void*>(ptr);
+    }
+
+    template <typename T>
+    const void* object_address(T* ptr, std::false_type) noexcept {
+        return ptr;
+    }
+
+#ifdef LINKED_PTR_DEBUG
+    // LINKED_PTR_DEBUG checks the ring on every change and keeps
+    // the registry of owned objects, what is still owned at exit is
+    // reported as leaked.
+
+    [[noreturn]] inline void ring_failure(const char* what, const void* node) noexcept {
+        std::fprintf(stderr, "linked_ptr: %s (%p)\n", what, node);
+        std::abort();
+    }
+
+    class ring_registry {
+    public:
+        void add(const void* ptr, const char* type) noexcept {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_live.emplace(ptr, type).second)
+                ring_failure("object is already owned by another ring", ptr);
+        }
+
+        void remove(const void* ptr) noexcept {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_live.erase(ptr) == 0)
+                ring_failure("deleting object which is not owned", ptr);
+        }
+
+        std::size_t size() noexcept {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _live.size();
+        }
+
+        void report_leaks() noexcept {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (auto const& live : _live)
+                std::fprintf(stderr, "linked_ptr: leaked %s (%p)\n", live.second, live.first);
+        }
+
+    private:
+        std::mutex _mutex;
+        std::unordered_map<const void*, const char*> _live;
+    };
+
+    // never destroyed, so owners with static storage can still use it;
+    // they are reported too if they own something at exit
+    inline ring_registry& live_rings() noexcept {
+        static ring_registry* registry = [] {
+            auto* r = new ring_registry;
+            std::atexit([] { live_rings().report_leaks(); });
+            return r;
+        }();
+        return *registry;
+    }
+
+    template <typename T>
+    void debug_acquire(T* ptr) noexcept {
+        if (ptr != nullptr)
+            live_rings().add(object_address(ptr, std::is_polymorphic<T>()), typeid(T).name());
+    }
+
+    template <typename T>
+    void debug_release(T* ptr) noexcept {
+        if (ptr != nullptr)
+            live_rings().remove(object_address(ptr, std::is_polymorphic<T>()));
+    }
+#else
+    template <typename T>
+    void debug_acquire(T*) noexcept {}
+
+    template <typename T>
+    void debug_release(T*) noexcept {}
+#endif
+
+#ifdef LINKED_PTR_THREAD_CHECK
+    // LINKED_PTR_THREAD_CHECK tags every ring node with the thread that
+    // linked it; a ring changed from another thread aborts with the
+    // stack of the offending copy, reset or swap. The tag is kept in the
+    // top bits of the left link, which user space addresses leave unused,
+    // so the node stays two pointers.
+    static_assert(sizeof(void*) == 8, "LINKED_PTR_THREAD_CHECK needs 64-bit pointers");
+
+    const unsigned thread_shift = 48;
+    const std::uintptr_t address_bits = (std::uintptr_t(1) << thread_shift) - 1;
+
+    // a number per thread in the top bits, 0 is left to the shared rings;
+    // after 65535 threads the numbers repeat
+    inline std::uintptr_t thread_tag() noexcept {
+        static thread_local std::uintptr_t tag = 0;
+        if (tag == 0) {
+            static std::atomic<std::uintptr_t> next(0);
+            tag = (next.fetch_add(1, std::memory_order_relaxed) % 0xffff + 1) << thread_shift;
+        }
+        return tag;
+    }
+
+    [[noreturn]] inline void thread_failure(const void* node, std::uintptr_t owner) noexcept {
+        std::fprintf(stderr, "linked_ptr: ring of thread %u changed from thread %u (%p)\n",
+                     static_cast<unsigned>(owner >> thread_shift),
+                     static_cast<unsigned>(thread_tag() >> thread_shift), node);
+#ifdef LINKED_PTR_BACKTRACE
+        void* frames[64];
+        backtrace_symbols_fd(frames, backtrace(frames, 64), 2);
+#endif
+        std::abort();
+    }
+#endif
+
+#ifndef LINKED_PTR_STATS
+    // see linked_ptr_stats.h
+    template <typename T>
+    void stats_acquire(const T*) noexcept {}
+
+    template <typename T, typename Node>
+    void stats_copy(const T*, const Node&) noexcept {}
+
+    template <typename T>
+    void stats_release(const T*, bool) noexcept {}
+#endif
+
+    // how many elements ahead the batch operations prefetch the ring
+    // neighbours: enough to cover a miss, few enough to stay in L1
+    const std::ptrdiff_t prefetch_distance = 16;
+
+    // asks for the cache line of a node which is about to be written
+    inline void prefetch(const void* ptr) noexcept {
+#if defined(__GNUC__)
+        __builtin_prefetch(ptr, 1);
+#else
+        (void) ptr;
+#endif
+    }
+
     struct linked_ptr_base {
         linked_ptr_base() noexcept {
             _left = this;
             _right = this;
+#ifdef LINKED_PTR_THREAD_CHECK
+            set_left(this, thread_tag());
+#endif
+        }
+
+        linked_ptr_base* left() const noexcept {
+#ifdef LINKED_PTR_THREAD_CHECK
+            return reinterpret_cast<linked_ptr_base*>(reinterpret_cast<std::uintptr_t>(_left) & address_bits);
+#else
+            return _left;
+#endif
+        }
+
+        // the thread of this element, 0 for the rings shared between
+        // threads and without LINKED_PTR_THREAD_CHECK
+        std::uintptr_t thread() const noexcept {
+#ifdef LINKED_PTR_THREAD_CHECK
+            return reinterpret_cast<std::uintptr_t>(_left) & ~address_bits;
+#else
+            return 0;
+#endif
+        }
+
+        // the elements of a ring have the same thread, so the ring
+        // changes write the left links without reading them first
+        void set_left(linked_ptr_base* node, std::uintptr_t thread) noexcept {
+#ifdef LINKED_PTR_THREAD_CHECK
+            _left = reinterpret_cast<linked_ptr_base*>(reinterpret_cast<std::uintptr_t>(node) | thread);
+#else
+            (void) thread;
+            _left = node;
+#endif
+        }
+
+        // keeps the thread of this element
+        void set_left(linked_ptr_base* node) noexcept {
+            set_left(node, thread());
+        }
+
+        // the ring of this element belongs to the current thread
+        // is checked only with LINKED_PTR_THREAD_CHECK
+        void check_thread() const noexcept {
+#ifdef LINKED_PTR_THREAD_CHECK
+            if (thread() != thread_tag() && thread() != 0)
+                thread_failure(this, thread());
+#endif
+        }
+
+        // this element joins a ring of the current thread
+        void adopt() noexcept {
+#ifdef LINKED_PTR_THREAD_CHECK
+            if (thread() != 0)
+                set_left(left(), thread_tag());
+#endif
         }
 
         // this element is the only one in the list
         bool unique() const noexcept {
-            return _left == this && _right == this;
+            return left() == this && _right == this;
+        }
+
+        // neighbours have to point back at this element
+        // is checked only with LINKED_PTR_DEBUG
+        void check() const noexcept {
+#ifdef LINKED_PTR_DEBUG
+            if (left()->_right != this || _right->left() != this)
+                ring_failure("ring is broken", this);
+#endif
         }
 
         void swap(linked_ptr_base& other) noexcept {
+            check();
+            other.check();
             // nothing to swap if the elements are unique
             if (unique() && other.unique())
                 return;
 
-            std::swap(_right, other._right);
-            std::swap(_left, other._left);
-
+            // a unique element takes over the ring of the other one
             if (!unique())
-                _right->_left = _left->_right = this;
+                check_thread();
             if (!other.unique())
-                other._right->_left = other._left->_right = &other;
+                other.check_thread();
+            adopt();
+            other.adopt();
+            const std::uintptr_t ring = thread();
+
+            std::swap(_right, other._right);
+            linked_ptr_base* own_left = left();
+            set_left(other.left(), ring);
+            other.set_left(own_left, ring);
+
+            // a unique element got the links pointing to the other one
+            if (_right == &other) {
+                set_left(this, ring);
+                _right = this;
+            } else {
+                left()->_right = this;
+                _right->set_left(this, ring);
+            }
+
+            if (other._right == this) {
+                other.set_left(&other, ring);
+                other._right = &other;
+            } else {
+                other.left()->_right = &other;
+                other._right->set_left(&other, ring);
+            }
+
+            check();
+            other.check();
         }
 
-        // insert this element after rhs
-        // is used only in linked_ptr constructors
+        // insert this element after rhs, this element has to be unique
+        // is used only in linked_ptr constructors and assignment
         void insert_after(linked_ptr_base& rhs) noexcept {
-            assert(unique());
+            rhs.check();
+            rhs.check_thread();
+            const std::uintptr_t ring = rhs.thread();
             _right = rhs._right;
-            _right->_left = this;
-            _left = &rhs;
+            _right->set_left(this, ring);
+            set_left(&rhs, ring);
             rhs._right = this;
+            check();
+        }
+
+        // insert the chain first..last after rhs; the chain is linked
+        // among itself already, with the thread of rhs, so only rhs and
+        // its right neighbour are written outside of it
+        static void splice_after(linked_ptr_base& rhs, linked_ptr_base& first, linked_ptr_base& last) noexcept {
+            rhs.check();
+            rhs.check_thread();
+            const std::uintptr_t ring = rhs.thread();
+            last._right = rhs._right;
+            last._right->set_left(&last, ring);
+            first.set_left(&rhs, ring);
+            rhs._right = &first;
+            first.check();
+            last.check();
         }
 
         void erase() noexcept {
-            _right->_left = _left;
-            _left->_right = _right;
-            _right = _left = this;
+            check();
+            check_thread();
+            const std::uintptr_t ring = thread();
+            _right->set_left(left(), ring);
+            left()->_right = _right;
+            set_left(this, ring);
+            _right = this;
         }
 
+        // with LINKED_PTR_THREAD_CHECK, read and written through
+        // left() and set_left() only
         linked_ptr_base* _left;
         linked_ptr_base* _right;
     };
 
+    // the ring node of policies which lock around the ring changes,
+    // exempt from LINKED_PTR_THREAD_CHECK
+    struct shared_links : linked_ptr_base {
+        shared_links() noexcept {
+#ifdef LINKED_PTR_THREAD_CHECK
+            _left = this;
+#endif
+        }
+    };
+
+    // gives library code (serializers, containers) access to the ring of a linked_ptr
+    struct linked_ptr_access;
+
 } // namespace details
 
-template <typename T>
+// Policies of linked_ptr, chosen at compile time. linked_ptr_policy<>
+// is the plain linked_ptr<T>: delete, no locking, assert.
+
+/// Deleter: how the last owner destroys the object
+struct default_deleter {
+    template <typename T>
+    static void destroy(T* ptr) noexcept {
+        delete ptr;
+    }
+};
+
+struct array_deleter {
+    template <typename T>
+    static void destroy(T* ptr) noexcept {
+        delete[] ptr;
+    }
+};
+
+/// Threading: a guard held around every change of a ring, and the ring
+/// node it goes with
+struct single_threaded {
+    using links = details::linked_ptr_base;
+
+    struct guard {
+        guard() noexcept {}
+    };
+};
+
+/// One lock for all the rings of the policy. It is recursive since
+/// destroying an object may release the pointers inside it.
+struct global_lock {
+    using links = details::shared_links;
+
+    class guard {
+    public:
+        guard() : _lock(mutex()) {}
+
+    private:
+        static std::recursive_mutex& mutex() {
+            static std::recursive_mutex instance;
+            return instance;
+        }
+
+        std::lock_guard<std::recursive_mutex> _lock;
+    };
+};
+
+/// Checking: what a broken precondition does
+struct assert_checking {
+    static void expect(bool condition) noexcept {
+        assert(condition);
+        (void) condition;
+    }
+};
+
+struct no_checking {
+    static void expect(bool) noexcept {}
+};
+
+struct abort_checking {
+    static void expect(bool condition) noexcept {
+        if (!condition)
+            std::abort();
+    }
+};
+
+/// The ring node is the one of the threading policy. It is not a policy
+/// of its own: the ring operations, the scans and the batch releases
+/// all work on details::linked_ptr_base with its layout.
+template <typename Deleter = default_deleter, typename Threading = single_threaded,
+          typename Checking = assert_checking>
+struct linked_ptr_policy {
+    using deleter = Deleter;
+    using threading = Threading;
+    using checking = Checking;
+    using links = typename Threading::links;
+};
+
+template <typename T, typename Policy = linked_ptr_policy<> >
 class linked_ptr {
-    template <typename Y>
+    template <typename Y, typename P>
     friend class linked_ptr;
 
+    friend struct details::linked_ptr_access;
+
 public:
     using element_type = T;
 
 private:
     template <typename Y>
     using type_compatible = std::enable_if_t<std::is_convertible<Y*, T*>::value>;
+    using guard = typename Policy::threading::guard;
+    using checking = typename Policy::checking;
+    static_assert(std::is_base_of<details::linked_ptr_base, typename Policy::links>::value
+                          && sizeof(typename Policy::links) == sizeof(details::linked_ptr_base),
+                  "the ring node of a threading policy has to be a linked_ptr_base");
     T* _ptr = nullptr;
-    mutable details::linked_ptr_base base;
+    mutable typename Policy::links base;
 
 public:
     // Constructors
@@ -80,17 +474,29 @@ public:
     explicit linked_ptr(std::nullptr_t) noexcept : linked_ptr() {}
 
     linked_ptr(const linked_ptr& rhs) noexcept {
+        guard lock;
+        LINKED_PTR_PROBE(copy, T, rhs.get(), rhs.unique());
+        checking::expect(unique());
         base.insert_after(rhs.base);
         _ptr = rhs.get();
+        details::stats_copy(_ptr, base);
     }
 
     template <typename Y, typename = type_compatible<Y> >
-    explicit linked_ptr(Y* ptr) noexcept : _ptr(static_cast<T*>(ptr)) {}
+    explicit linked_ptr(Y* ptr) noexcept : _ptr(static_cast<T*>(ptr)) {
+        LINKED_PTR_PROBE(construct, T, _ptr, true);
+        details::debug_acquire(_ptr);
+        details::stats_acquire(_ptr);
+    }
 
     template <typename Y, typename = type_compatible<Y> >
-    linked_ptr(const linked_ptr<Y>& rhs) noexcept {
+    linked_ptr(const linked_ptr<Y, Policy>& rhs) noexcept {
+        guard lock;
+        LINKED_PTR_PROBE(copy, T, rhs.get(), rhs.unique());
+        checking::expect(unique());
         base.insert_after(rhs.base);
         _ptr = static_cast<T*>(rhs.get());
+        details::stats_copy(_ptr, base);
     }
 
     ~linked_ptr() {
@@ -111,14 +517,17 @@ public:
 
     template <typename Y, typename = type_compatible<Y> >
     void reset(Y* ptr) {
-        if (unique()) delete _ptr;
-        else base.erase();
+        LINKED_PTR_PROBE(reset, T, _ptr, unique());
+        release();
         _ptr = ptr;
+        LINKED_PTR_PROBE(construct, T, _ptr, true);
+        details::debug_acquire(_ptr);
+        details::stats_acquire(_ptr);
     }
 
     void reset() noexcept {
-        if (unique()) delete _ptr;
-        else base.erase();
+        LINKED_PTR_PROBE(reset, T, _ptr, unique());
+        release();
         _ptr = nullptr;
     }
 
@@ -126,16 +535,37 @@ public:
         if (_ptr == other._ptr)
             return;
 
+        guard lock;
+        LINKED_PTR_PROBE(swap, T, _ptr, unique());
+
         base.swap(other.base);
         std::swap(_ptr, other._ptr);
     }
 
+    /// Makes every pointer in [first, last) an owner of this object,
+    /// linking the new owners among themselves and splicing them into the
+    /// ring at once. The range must not contain this pointer.
+    template <typename It>
+    void clone_into(It first, It last) const noexcept {
+        share_with(static_cast<std::size_t>(std::distance(first, last)), [&]() -> linked_ptr& {
+            linked_ptr& owner = *first++;
+            checking::expect(&owner != this);
+            owner.reset();
+            return owner;
+        });
+    }
+
     // Operators
 
+    // the implicit one would copy the ring links
+    linked_ptr& operator=(const linked_ptr& rhs) noexcept {
+        assign(rhs.base, rhs.get());
+        return *this;
+    }
+
     template <typename Y, typename = type_compatible<Y> >
-    linked_ptr& operator=(const linked_ptr<Y>& rhs) noexcept {
-        reset(rhs.get());
-        insert_after(const_cast<linked_ptr<Y>&>(rhs));
+    linked_ptr& operator=(const linked_ptr<Y, Policy>& rhs) noexcept {
+        assign(rhs.base, static_cast<T*>(rhs.get()));
         return *this;
     }
 
@@ -152,39 +582,525 @@ public:
     explicit operator bool() const noexcept {
         return _ptr != nullptr;
     }
+
+private:
+    // makes n empty owners, returned one by one by next(), share the
+    // object of this one with a single splice into the ring
+    template <typename Next>
+    void share_with(std::size_t n, Next&& next) const noexcept {
+        if (n == 0)
+            return;
+
+        guard lock;
+        // the new owners take the thread of the ring they are spliced into
+        const std::uintptr_t ring = base.thread();
+        details::linked_ptr_base* first = nullptr;
+        details::linked_ptr_base* last = nullptr;
+        for (std::size_t i = 0; i < n; ++i) {
+            linked_ptr& owner = next();
+            checking::expect(owner.unique() && !owner);
+            LINKED_PTR_PROBE(copy, T, _ptr, i == 0 && unique());
+            owner._ptr = _ptr;
+            if (last != nullptr) {
+                last->_right = &owner.base;
+                owner.base.set_left(last, ring);
+            } else {
+                first = &owner.base;
+            }
+            last = &owner.base;
+        }
+        details::linked_ptr_base::splice_after(base, *first, *last);
+
+#ifdef LINKED_PTR_STATS
+        for (details::linked_ptr_base* node = first;; node = node->_right) {
+            details::stats_copy(_ptr, *node);
+            if (node == last)
+                break;
+        }
+#endif
+    }
+
+    // releases every pointer of the array, see destroy_range
+    static void release_range(linked_ptr* first, linked_ptr* last) noexcept {
+        using details::linked_ptr_base;
+        const std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(first);
+        const std::uintptr_t end = reinterpret_cast<std::uintptr_t>(last);
+        auto owner = [&](linked_ptr_base* node) -> linked_ptr* {
+            std::uintptr_t address = reinterpret_cast<std::uintptr_t>(node);
+            return address >= begin && address < end ? first + (address - begin) / sizeof(linked_ptr) : nullptr;
+        };
+        const std::ptrdiff_t distance = details::prefetch_distance;
+
+        guard lock;
+        for (linked_ptr* p = first; p != last; ++p) {
+            if (last - p > distance)
+                p[distance].prefetch_ring();
+            linked_ptr_base* left = p->base.left();
+            linked_ptr_base* right = p->base._right;
+            if (p + 1 == last || right != &p[1].base) {
+                // unique, or a neighbour elsewhere: the prefetched nodes
+                // are written at once
+                p->reset();
+                continue;
+            }
+
+            // the owners following this one in the array are its ring
+            // neighbours too (made by clone_into or in a row): the run
+            // is cut out of the ring at once, with two writes outside
+            p->base.check_thread();
+            p->base._right = &p->base;
+            p->base.set_left(&p->base);
+            linked_ptr* next = p + 1;
+            bool closed = false;
+            for (linked_ptr* current = owner(right); current != nullptr;) {
+                if (current == p) {
+                    closed = true;
+                    break;
+                }
+                right = current->base._right;
+                current->detach();
+                if (current != next) {
+                    current = owner(right);
+                    continue;
+                }
+                // owners made in a row (by clone_into) need no second look,
+                // and the next one is found by a predicted branch rather
+                // than by waiting for the load
+                ++next;
+                if (next != last && right == &next->base)
+                    current = next;
+                else
+                    current = owner(right);
+            }
+
+            if (closed) {
+                // the whole ring is in the array: the object goes away
+                p->reset();
+            } else {
+                p->detach();
+                for (linked_ptr* current = owner(left); current != nullptr; current = owner(left)) {
+                    left = current->base.left();
+                    current->detach();
+                }
+                left->_right = right;
+                right->set_left(left);
+                left->check();
+            }
+            p = next - 1;
+        }
+    }
+
+    // see copy_n
+    static void copy_range(const linked_ptr* src, std::size_t n, linked_ptr* dst) noexcept {
+        const std::size_t distance = details::prefetch_distance;
+        guard lock;
+        for (std::size_t i = 0; i < n; ++i) {
+            if (n - i > distance) {
+                // insert_after writes the right neighbour of the source
+                details::prefetch(src[i + distance].base._right);
+                dst[i + distance].prefetch_ring();
+            }
+            // src[i] may live inside the object dst[i] owns
+            dst[i].assign(src[i].base, src[i]._ptr);
+        }
+    }
+
+    // see reset_n
+    static void reset_range(linked_ptr* first, std::size_t n) noexcept {
+        const std::size_t distance = details::prefetch_distance;
+        guard lock;
+        for (std::size_t i = 0; i < n; ++i) {
+            if (n - i > distance)
+                first[i + distance].prefetch_ring();
+            first[i].reset();
+        }
+    }
+
+    // the neighbours written when this owner leaves the ring
+    void prefetch_ring() const noexcept {
+        details::prefetch(base.left());
+        details::prefetch(base._right);
+    }
+
+    // gives up a shared ownership, the caller fixes the ring
+    void detach() noexcept {
+        LINKED_PTR_PROBE(reset, T, _ptr, false);
+        details::stats_release(_ptr, false);
+        base._right = &base;
+        base.set_left(&base);
+        _ptr = nullptr;
+    }
+
+    // leaves the ring for the one of ring, which owns ptr; the old object
+    // is destroyed last, since ring may belong to an owner inside it
+    void assign(details::linked_ptr_base& ring, T* ptr) noexcept {
+        if (_ptr == ptr)
+            return;
+
+        guard lock;
+        LINKED_PTR_PROBE(reset, T, _ptr, unique());
+        T* old = _ptr;
+        const bool last = unique();
+        details::stats_release(old, last);
+        if (!last)
+            base.erase();
+
+        LINKED_PTR_PROBE(copy, T, ptr, ring.unique());
+        base.insert_after(ring);
+        _ptr = ptr;
+        details::stats_copy(_ptr, base);
+
+        if (last) {
+            if (old != nullptr)
+                LINKED_PTR_PROBE(destroy, T, old, true);
+            details::debug_release(old);
+            Policy::deleter::destroy(old);
+        }
+    }
+
+    void release() noexcept {
+        guard lock;
+        details::stats_release(_ptr, unique());
+        if (unique()) {
+            if (_ptr != nullptr)
+                LINKED_PTR_PROBE(destroy, T, _ptr, true);
+            details::debug_release(_ptr);
+            Policy::deleter::destroy(_ptr);
+        } else {
+            base.erase();
+        }
+    }
 }; // linked_ptr
 
+namespace details {
+
+    struct linked_ptr_access {
+        template <typename T, typename P>
+        static linked_ptr_base& base(const linked_ptr<T, P>& ptr) noexcept {
+            return ptr.base;
+        }
+
+        template <typename T, typename P>
+        static T*& pointee(linked_ptr<T, P>& ptr) noexcept {
+            return ptr._ptr;
+        }
+
+        template <typename T, typename P>
+        static T* const& pointee(const linked_ptr<T, P>& ptr) noexcept {
+            return ptr._ptr;
+        }
+
+        // the owner of a ring node, all the owners in the ring are linked_ptr<T>
+        template <typename T>
+        static linked_ptr<T>& owner(linked_ptr_base& node) noexcept {
+            return *reinterpret_cast<linked_ptr<T>*>(reinterpret_cast<char*>(&node) - offsetof(linked_ptr<T>, base));
+        }
+
+        // see linked_ptr::share_with
+        template <typename T, typename P, typename Next>
+        static void share(const linked_ptr<T, P>& ptr, std::size_t n, Next&& next) noexcept {
+            ptr.share_with(n, std::forward<Next>(next));
+        }
+
+        template <typename T, typename P>
+        static void release_range(linked_ptr<T, P>* first, linked_ptr<T, P>* last) noexcept {
+            linked_ptr<T, P>::release_range(first, last);
+        }
+
+        template <typename T, typename P>
+        static void copy_range(const linked_ptr<T, P>* src, std::size_t n, linked_ptr<T, P>* dst) noexcept {
+            linked_ptr<T, P>::copy_range(src, n, dst);
+        }
+
+        template <typename T, typename P>
+        static void reset_range(linked_ptr<T, P>* first, std::size_t n) noexcept {
+            linked_ptr<T, P>::reset_range(first, n);
+        }
+    };
+
+} // namespace details
+
+/// Releases every pointer of the array [first, last) like reset() and
+/// leaves them empty, so destroying them afterwards costs nothing.
+/// Owners whose ring neighbours are in the array too are unlinked as a
+/// group: only the ends of such a run write outside the array, and
+/// the neighbours of the next owners are prefetched ahead. An object
+/// owned only from inside the array is deleted once.
+template <typename T, typename P>
+void destroy_range(linked_ptr<T, P>* first, linked_ptr<T, P>* last) noexcept {
+    details::linked_ptr_access::release_range(first, last);
+}
+
+/// dst[i] = src[i] for the n elements of two arrays which do not overlap.
+/// The ring nodes written for an element are prefetched a few elements
+/// ahead, so the misses on large rings overlap instead of adding up.
+template <typename T, typename P>
+void copy_n(const linked_ptr<T, P>* src, std::size_t n, linked_ptr<T, P>* dst) noexcept {
+    details::linked_ptr_access::copy_range(src, n, dst);
+}
+
+/// reset() on the n elements of an array, with the same prefetching
+template <typename T, typename P>
+void reset_n(linked_ptr<T, P>* first, std::size_t n) noexcept {
+    details::linked_ptr_access::reset_range(first, n);
+}
+
 /// Logic operators
-template <typename T, typename Y>
-bool operator==(const linked_ptr<T>& lhs, const linked_ptr<Y>& rhs) noexcept {
+template <typename T, typename P, typename Y, typename Q>
+bool operator==(const linked_ptr<T, P>& lhs, const linked_ptr<Y, Q>& rhs) noexcept {
     return lhs.get() == rhs.get();
 }
 
-template <typename T, typename Y>
-bool operator!=(const linked_ptr<T>& lhs, const linked_ptr<Y>& rhs) noexcept {
+template <typename T, typename P, typename Y, typename Q>
+bool operator!=(const linked_ptr<T, P>& lhs, const linked_ptr<Y, Q>& rhs) noexcept {
     return !(lhs == rhs);
 }
 
-template <typename T, typename Y>
-bool operator<(const linked_ptr<T>& lhs, const linked_ptr<Y>& rhs) noexcept {
+template <typename T, typename P, typename Y, typename Q>
+bool operator<(const linked_ptr<T, P>& lhs, const linked_ptr<Y, Q>& rhs) noexcept {
     return std::less<>()(static_cast<void*>(lhs.get()), static_cast<void*>(rhs.get()));
 }
 
-template <typename T, typename Y>
-bool operator>(const linked_ptr<T>& lhs, const linked_ptr<Y>& rhs) noexcept {
+template <typename T, typename P, typename Y, typename Q>
+bool operator>(const linked_ptr<T, P>& lhs, const linked_ptr<Y, Q>& rhs) noexcept {
     return !(lhs < rhs) && !(lhs == rhs);
 }
 
-template <typename T, typename Y>
-bool operator<=(const linked_ptr<T>& lhs, const linked_ptr<Y>& rhs) noexcept {
+template <typename T, typename P, typename Y, typename Q>
+bool operator<=(const linked_ptr<T, P>& lhs, const linked_ptr<Y, Q>& rhs) noexcept {
     return !(lhs > rhs);
 }
 
-template <typename T, typename Y>
-bool operator>=(const linked_ptr<T>& lhs, const linked_ptr<Y>& rhs) noexcept {
+template <typename T, typename P, typename Y, typename Q>
+bool operator>=(const linked_ptr<T, P>& lhs, const linked_ptr<Y, Q>& rhs) noexcept {
+    return !(lhs < rhs);
+}
+
+/// Comparisons with raw pointers and nullptr, which need no owner
+template <typename T, typename P, typename Y>
+bool operator==(const linked_ptr<T, P>& lhs, Y* rhs) noexcept {
+    return lhs.get() == rhs;
+}
+
+template <typename T, typename P, typename Y>
+bool operator==(Y* lhs, const linked_ptr<T, P>& rhs) noexcept {
+    return lhs == rhs.get();
+}
+
+template <typename T, typename P, typename Y>
+bool operator!=(const linked_ptr<T, P>& lhs, Y* rhs) noexcept {
+    return !(lhs == rhs);
+}
+
+template <typename T, typename P, typename Y>
+bool operator!=(Y* lhs, const linked_ptr<T, P>& rhs) noexcept {
+    return !(lhs == rhs);
+}
+
+template <typename T, typename P>
+bool operator==(const linked_ptr<T, P>& lhs, std::nullptr_t) noexcept {
+    return !lhs;
+}
+
+template <typename T, typename P>
+bool operator==(std::nullptr_t, const linked_ptr<T, P>& rhs) noexcept {
+    return !rhs;
+}
+
+template <typename T, typename P>
+bool operator!=(const linked_ptr<T, P>& lhs, std::nullptr_t) noexcept {
+    return static_cast<bool>(lhs);
+}
+
+template <typename T, typename P>
+bool operator!=(std::nullptr_t, const linked_ptr<T, P>& rhs) noexcept {
+    return static_cast<bool>(rhs);
+}
+
+/// Ordered by address, in the total order of std::less like the owners
+template <typename T, typename P, typename Y>
+bool operator<(const linked_ptr<T, P>& lhs, Y* rhs) noexcept {
+    return std::less<const volatile void*>()(lhs.get(), rhs);
+}
+
+template <typename T, typename P, typename Y>
+bool operator<(Y* lhs, const linked_ptr<T, P>& rhs) noexcept {
+    return std::less<const volatile void*>()(lhs, rhs.get());
+}
+
+template <typename T, typename P, typename Y>
+bool operator>(const linked_ptr<T, P>& lhs, Y* rhs) noexcept {
+    return rhs < lhs;
+}
+
+template <typename T, typename P, typename Y>
+bool operator>(Y* lhs, const linked_ptr<T, P>& rhs) noexcept {
+    return rhs < lhs;
+}
+
+template <typename T, typename P, typename Y>
+bool operator<=(const linked_ptr<T, P>& lhs, Y* rhs) noexcept {
+    return !(rhs < lhs);
+}
+
+template <typename T, typename P, typename Y>
+bool operator<=(Y* lhs, const linked_ptr<T, P>& rhs) noexcept {
+    return !(rhs < lhs);
+}
+
+template <typename T, typename P, typename Y>
+bool operator>=(const linked_ptr<T, P>& lhs, Y* rhs) noexcept {
     return !(lhs < rhs);
 }
 
+template <typename T, typename P, typename Y>
+bool operator>=(Y* lhs, const linked_ptr<T, P>& rhs) noexcept {
+    return !(lhs < rhs);
+}
+
+template <typename T, typename P>
+bool operator<(const linked_ptr<T, P>& lhs, std::nullptr_t) noexcept {
+    return lhs < static_cast<T*>(nullptr);
+}
+
+template <typename T, typename P>
+bool operator<(std::nullptr_t, const linked_ptr<T, P>& rhs) noexcept {
+    return static_cast<T*>(nullptr) < rhs;
+}
+
+template <typename T, typename P>
+bool operator>(const linked_ptr<T, P>& lhs, std::nullptr_t) noexcept {
+    return nullptr < lhs;
+}
+
+template <typename T, typename P>
+bool operator>(std::nullptr_t, const linked_ptr<T, P>& rhs) noexcept {
+    return rhs < nullptr;
+}
+
+template <typename T, typename P>
+bool operator<=(const linked_ptr<T, P>& lhs, std::nullptr_t) noexcept {
+    return !(nullptr < lhs);
+}
+
+template <typename T, typename P>
+bool operator<=(std::nullptr_t, const linked_ptr<T, P>& rhs) noexcept {
+    return !(rhs < nullptr);
+}
+
+template <typename T, typename P>
+bool operator>=(const linked_ptr<T, P>& lhs, std::nullptr_t) noexcept {
+    return !(lhs < nullptr);
+}
+
+template <typename T, typename P>
+bool operator>=(std::nullptr_t, const linked_ptr<T, P>& rhs) noexcept {
+    return !(nullptr < rhs);
+}
+
+namespace details {
+
+    template <typename T, typename P>
+    T* raw(const linked_ptr<T, P>& ptr) noexcept {
+        return ptr.get();
+    }
+
+    template <typename T>
+    T* raw(T* ptr) noexcept {
+        return ptr;
+    }
+
+    inline std::nullptr_t raw(std::nullptr_t) noexcept {
+        return nullptr;
+    }
+
+} // namespace details
+
+/// Transparent comparators and hash: containers of linked_ptr are
+/// searched by raw pointer without making an owner for the key.
+/// ptr_less orders the pointers themselves.
+struct ptr_less {
+    using is_transparent = void;
+
+    template <typename L, typename R>
+    bool operator()(const L& lhs, const R& rhs) const noexcept {
+        return less(details::raw(lhs), details::raw(rhs));
+    }
+
+private:
+    // pointers to a class and its base are compared as the base
+    template <typename L, typename R>
+    static bool less(L* lhs, R* rhs) noexcept {
+        return std::less<>()(lhs, rhs);
+    }
+
+    template <typename L, typename R>
+    static bool less(const L& lhs, const R& rhs) noexcept {
+        return std::less<const volatile void*>()(lhs, rhs);
+    }
+};
+
+/// Orders by the owned object, which is the same through linked_ptrs
+/// to different bases of it
+struct owner_less {
+    using is_transparent = void;
+
+    template <typename L, typename R>
+    bool operator()(const L& lhs, const R& rhs) const noexcept {
+        return std::less<const void*>()(object(details::raw(lhs)), object(details::raw(rhs)));
+    }
+
+private:
+    template <typename T>
+    static const void* object(T* ptr) noexcept {
+        return ptr != nullptr ? details::object_address(ptr, std::is_polymorphic<T>()) : nullptr;
+    }
+
+    static const void* object(std::nullptr_t) noexcept {
+        return nullptr;
+    }
+};
+
+struct ptr_equal {
+    using is_transparent = void;
+
+    template <typename L, typename R>
+    bool operator()(const L& lhs, const R& rhs) const noexcept {
+        return details::raw(lhs) == details::raw(rhs);
+    }
+};
+
+/// The same value as std::hash<T*>, for linked_ptr<T> and T*
+struct ptr_hash {
+    using is_transparent = void;
+
+    template <typename L>
+    std::size_t operator()(const L& ptr) const noexcept {
+        return hash(details::raw(ptr));
+    }
+
+private:
+    template <typename T>
+    static std::size_t hash(T* ptr) noexcept {
+        return std::hash<T*>()(ptr);
+    }
+
+    static std::size_t hash(std::nullptr_t) noexcept {
+        return std::hash<void*>()(nullptr);
+    }
+};
+
 } // namespace smart_ptr
 
+namespace std {
+
+template <typename T, typename P>
+struct hash<smart_ptr::linked_ptr<T, P> > {
+    std::size_t operator()(const smart_ptr::linked_ptr<T, P>& ptr) const noexcept {
+        return std::hash<T*>()(ptr.get());
+    }
+};
+
+} // namespace std
+
 #endif // LINKED_PTR_H
@@ -0,0 +1,160 @@
+#ifndef LINKED_PTR_ARENA_H
+#define LINKED_PTR_ARENA_H
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#ifdef LINKED_PTR_DEBUG
+#include <unordered_set>
+#endif
+
+#include "linked_ptr.h"
+
+namespace smart_ptr {
+
+/// Owners which die together, at shutdown or at the end of a phase.
+/// teardown() drops them without maintaining the rings: the first
+/// adopted owner of an object empties the others of its ring in place,
+/// without relinking anything, and the object is deleted once.
+///
+/// Every owner of these objects has to be adopted, including the ones
+/// inside the objects, and stay alive until teardown(); with
+/// LINKED_PTR_DEBUG a ring leaving the arena is reported. The owners of
+/// an object have to be of one type (no linked_ptr to one of its bases).
+class linked_ptr_arena {
+public:
+    linked_ptr_arena() = default;
+
+    linked_ptr_arena(const linked_ptr_arena&) = delete;
+    linked_ptr_arena& operator=(const linked_ptr_arena&) = delete;
+
+    ~linked_ptr_arena() {
+        teardown();
+    }
+
+    template <typename T>
+    void adopt(linked_ptr<T>& owner) {
+        adopt(&owner, &owner + 1);
+    }
+
+    /// Adopts an array of owners, which costs the same as one owner
+    template <typename T>
+    void adopt(linked_ptr<T>* first, linked_ptr<T>* last) {
+        range r;
+        r.first = first;
+        r.size = static_cast<std::size_t>(last - first);
+        r.drop = &drop<T>;
+#ifdef LINKED_PTR_DEBUG
+        r.nodes = &nodes<T>;
+#endif
+        _ranges.push_back(r);
+        _owners += r.size;
+    }
+
+    /// Number of adopted owners
+    std::size_t size() const noexcept {
+        return _owners;
+    }
+
+    /// Empties every adopted owner and deletes what they owned
+    void teardown() {
+        check_closed();
+
+        // all the owners are emptied first: deleting an object destroys
+        // the owners inside it, which must not delete anything
+        std::vector<object> objects;
+        for (const range& r : _ranges)
+            r.drop(r, objects);
+        for (const object& o : objects)
+            o.release(o.address);
+
+        _ranges.clear();
+        _owners = 0;
+    }
+
+private:
+    struct object {
+        void* address;
+        void (*release)(void* object) noexcept;
+    };
+
+    struct range {
+        void* first;
+        std::size_t size;
+        void (*drop)(const range& r, std::vector<object>& objects);
+#ifdef LINKED_PTR_DEBUG
+        void (*nodes)(const range& r, std::vector<const details::linked_ptr_base*>& out);
+#endif
+    };
+
+    // empties the owners, the first one of a ring seen here empties the
+    // others and reports the object
+    template <typename T>
+    static void drop(const range& r, std::vector<object>& objects) {
+        using access = details::linked_ptr_access;
+        linked_ptr<T>* owners = static_cast<linked_ptr<T>*>(r.first);
+        const std::size_t distance = details::prefetch_distance;
+        for (std::size_t i = 0; i < r.size; ++i) {
+            if (r.size - i > distance)
+                details::prefetch(access::base(owners[i + distance])._right);
+
+            details::linked_ptr_base& node = access::base(owners[i]);
+            T*& ptr = access::pointee(owners[i]);
+            if (ptr == nullptr && node.unique())
+                continue;
+            if (ptr != nullptr)
+                objects.push_back(object{const_cast<std::remove_cv_t<T>*>(ptr), &release<T>});
+
+            for (details::linked_ptr_base* other = node._right; other != &node;) {
+                details::linked_ptr_base* next = other->_right;
+                T*& other_ptr = access::pointee(access::owner<T>(*other));
+                details::stats_release(other_ptr, false);
+                other_ptr = nullptr;
+                other->_right = other;
+                other->set_left(other);
+                other = next;
+            }
+            node._right = &node;
+            node.set_left(&node);
+            ptr = nullptr;
+        }
+    }
+
+    template <typename T>
+    static void release(void* object) noexcept {
+        T* ptr = static_cast<T*>(object);
+        details::stats_release(ptr, true);
+        details::debug_release(ptr);
+        delete ptr;
+    }
+
+#ifdef LINKED_PTR_DEBUG
+    template <typename T>
+    static void nodes(const range& r, std::vector<const details::linked_ptr_base*>& out) {
+        linked_ptr<T>* owners = static_cast<linked_ptr<T>*>(r.first);
+        for (std::size_t i = 0; i < r.size; ++i)
+            out.push_back(&details::linked_ptr_access::base(owners[i]));
+    }
+#endif
+
+    void check_closed() const {
+#ifdef LINKED_PTR_DEBUG
+        std::vector<const details::linked_ptr_base*> all;
+        for (const range& r : _ranges)
+            r.nodes(r, all);
+        std::unordered_set<const void*> adopted(all.begin(), all.end());
+        for (const details::linked_ptr_base* node : all) {
+            if (adopted.count(node->_right) == 0)
+                details::ring_failure("an owner outside of the arena shares an adopted object", node->_right);
+        }
+#endif
+    }
+
+    std::vector<range> _ranges;
+    std::size_t _owners = 0;
+};
+
+} // namespace smart_ptr
+
+#endif // LINKED_PTR_ARENA_H
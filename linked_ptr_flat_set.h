@@ -0,0 +1,244 @@
+#ifndef LINKED_PTR_FLAT_SET_H
+#define LINKED_PTR_FLAT_SET_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "linked_ptr.h"
+
+namespace smart_ptr {
+
+/// Set of owners sorted by the address of the object, in one array.
+/// The addresses are kept in an array of their own, so a lookup is a
+/// branchless binary search over 8-byte keys that touches the owners
+/// only for the result. Inserting a batch sorts it and merges it in
+/// one pass. The owners never move by copy: a grown or merged array is
+/// filled by swapping them in, which relinks their ring neighbours and
+/// nothing else.
+template <typename T>
+class linked_ptr_flat_set {
+    // owners to add, sorted by address
+    using batch_type = std::vector<std::pair<std::uintptr_t, const linked_ptr<T>*>>;
+
+public:
+    using value_type = linked_ptr<T>;
+    using const_iterator = typename std::vector<linked_ptr<T>>::const_iterator;
+
+    linked_ptr_flat_set() noexcept = default;
+
+    template <typename It>
+    linked_ptr_flat_set(It first, It last) {
+        insert(first, last);
+    }
+
+    linked_ptr_flat_set(const linked_ptr_flat_set&) = default;
+
+    linked_ptr_flat_set(linked_ptr_flat_set&& other) noexcept
+            : _owners(std::move(other._owners)), _keys(std::move(other._keys)) {}
+
+    linked_ptr_flat_set& operator=(linked_ptr_flat_set other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~linked_ptr_flat_set() {
+        clear();
+    }
+
+    // Info
+
+    std::size_t size() const noexcept {
+        return _keys.size();
+    }
+
+    bool empty() const noexcept {
+        return _keys.empty();
+    }
+
+    const_iterator begin() const noexcept {
+        return _owners.begin();
+    }
+
+    const_iterator end() const noexcept {
+        return _owners.end();
+    }
+
+    /// key: a linked_ptr or a raw pointer to the object
+    template <typename K>
+    const_iterator find(const K& key) const noexcept {
+        std::uintptr_t address = key_of(details::raw(key));
+        std::size_t i = lower_bound(address);
+        return i < _keys.size() && _keys[i] == address ? begin() + i : end();
+    }
+
+    template <typename K>
+    bool contains(const K& key) const noexcept {
+        return find(key) != end();
+    }
+
+    template <typename K>
+    std::size_t count(const K& key) const noexcept {
+        return contains(key);
+    }
+
+    // Modification
+
+    /// false if the object is already there or ptr is empty
+    bool insert(const linked_ptr<T>& ptr) {
+        if (!ptr)
+            return false;
+        std::uintptr_t address = key_of(ptr.get());
+        std::size_t i = lower_bound(address);
+        if (i < _keys.size() && _keys[i] == address)
+            return false;
+
+        if (_owners.size() == _owners.capacity())
+            regrow(std::max<std::size_t>(16, 2 * _owners.size()));
+        _owners.emplace_back();
+        for (std::size_t j = _owners.size() - 1; j > i; --j)
+            _owners[j].swap(_owners[j - 1]);
+        _owners[i] = ptr;
+        _keys.insert(_keys.begin() + i, address);
+        return true;
+    }
+
+    /// Inserts the owners of [first, last) at once, returns the number of new objects.
+    /// The batch points at the owners, so the iterators have to yield lvalues.
+    template <typename It>
+    std::size_t insert(It first, It last) {
+        static_assert(std::is_lvalue_reference<typename std::iterator_traits<It>::reference>::value,
+                      "linked_ptr_flat_set::insert: the iterators have to yield stored owners");
+        batch_type batch;
+        for (; first != last; ++first) {
+            const linked_ptr<T>& ptr = *first;
+            if (ptr)
+                batch.emplace_back(key_of(ptr.get()), &ptr);
+        }
+        std::sort(batch.begin(), batch.end(), [](auto const& lhs, auto const& rhs) { return lhs.first < rhs.first; });
+        batch.erase(std::unique(batch.begin(), batch.end(), [](auto const& lhs, auto const& rhs) {
+            return lhs.first == rhs.first;
+        }), batch.end());
+        return merge(batch);
+    }
+
+    /// Adds the objects of other
+    std::size_t merge(const linked_ptr_flat_set& other) {
+        batch_type batch;
+        batch.reserve(other.size());
+        for (std::size_t i = 0; i < other.size(); ++i)
+            batch.emplace_back(other._keys[i], &other._owners[i]);
+        return merge(batch);
+    }
+
+    /// false if the object is not there
+    template <typename K>
+    bool erase(const K& key) noexcept {
+        std::uintptr_t address = key_of(details::raw(key));
+        std::size_t i = lower_bound(address);
+        if (i == _keys.size() || _keys[i] != address)
+            return false;
+        _owners[i].reset();
+        for (std::size_t j = i + 1; j < _owners.size(); ++j)
+            _owners[j - 1].swap(_owners[j]);
+        _owners.pop_back();
+        _keys.erase(_keys.begin() + i);
+        return true;
+    }
+
+    void reserve(std::size_t capacity) {
+        if (capacity > _owners.capacity())
+            regrow(capacity);
+        _keys.reserve(capacity);
+    }
+
+    void clear() noexcept {
+        destroy_range(_owners.data(), _owners.data() + _owners.size());
+        _owners.clear();
+        _keys.clear();
+    }
+
+    void swap(linked_ptr_flat_set& other) noexcept {
+        _owners.swap(other._owners);
+        _keys.swap(other._keys);
+    }
+
+private:
+    static std::uintptr_t key_of(const T* ptr) noexcept {
+        return reinterpret_cast<std::uintptr_t>(ptr);
+    }
+
+    // the first key not less than address; the halving is a conditional
+    // move, and both possible next probes are prefetched
+    std::size_t lower_bound(std::uintptr_t address) const noexcept {
+        std::size_t n = _keys.size();
+        if (n == 0)
+            return 0;
+        const std::uintptr_t* base = _keys.data();
+        while (n > 1) {
+            std::size_t half = n / 2;
+            details::prefetch(base + half / 2);
+            details::prefetch(base + half + half / 2);
+            base = base[half] < address ? base + half : base;
+            n -= half;
+        }
+        return static_cast<std::size_t>(base - _keys.data()) + (*base < address);
+    }
+
+    // moves the owners into an array of the given capacity
+    void regrow(std::size_t capacity) {
+        std::vector<linked_ptr<T>> owners;
+        owners.reserve(capacity);
+        owners.resize(_owners.size());
+        for (std::size_t i = 0; i < _owners.size(); ++i)
+            owners[i].swap(_owners[i]);
+        _owners.swap(owners);
+    }
+
+    // merges a sorted batch without duplicates, copying its new owners
+    std::size_t merge(const batch_type& batch) {
+        std::size_t added = 0;
+        for (auto const& entry : batch)
+            added += !contains_key(entry.first);
+        if (added == 0)
+            return 0;
+
+        std::size_t n = _keys.size() + added;
+        std::vector<linked_ptr<T>> owners(n);
+        std::vector<std::uintptr_t> keys(n);
+        std::size_t i = 0;
+        auto next = batch.begin();
+        for (std::size_t k = 0; k < n; ++k) {
+            while (next != batch.end() && i < _keys.size() && next->first == _keys[i])
+                ++next;
+            if (next == batch.end() || (i < _keys.size() && _keys[i] < next->first)) {
+                owners[k].swap(_owners[i]);
+                keys[k] = _keys[i++];
+            } else {
+                owners[k] = *next->second;
+                keys[k] = next->first;
+                ++next;
+            }
+        }
+        _owners.swap(owners);
+        _keys.swap(keys);
+        return added;
+    }
+
+    bool contains_key(std::uintptr_t address) const noexcept {
+        std::size_t i = lower_bound(address);
+        return i < _keys.size() && _keys[i] == address;
+    }
+
+    // sorted by key, _keys[i] is the address of *_owners[i]
+    std::vector<linked_ptr<T>> _owners;
+    std::vector<std::uintptr_t> _keys;
+};
+
+} // namespace smart_ptr
+
+#endif // LINKED_PTR_FLAT_SET_H
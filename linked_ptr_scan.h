@@ -0,0 +1,215 @@
+#ifndef LINKED_PTR_SCAN_H
+#define LINKED_PTR_SCAN_H
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#include "linked_ptr.h"
+
+#if defined(__x86_64__) && (defined(__AVX2__) || defined(__SSE2__))
+#include <immintrin.h>
+#define LINKED_PTR_SCAN_SIMD
+#endif
+
+namespace smart_ptr {
+
+namespace details {
+
+    // the object pointer of an owner, read by the kernels as raw bytes
+    // at a stride of sizeof(linked_ptr); it is the first member, so the
+    // loads of the packed kernels stay inside the owners they look at
+    template <typename T, typename P>
+    const char* pointee_bytes(const linked_ptr<T, P>* ptr) noexcept {
+        return reinterpret_cast<const char*>(&linked_ptr_access::pointee(*ptr));
+    }
+
+    // the owners of the default policy: the object pointer and two links
+    using packed_stride = std::integral_constant<std::size_t, 3 * sizeof(void*)>;
+
+#if defined(LINKED_PTR_SCAN_SIMD) && defined(__AVX2__)
+    const std::size_t scan_lanes = 4;
+
+    // bit i: the pointer at first + i * stride is target
+    template <std::size_t Stride>
+    unsigned scan_equal(const char* first, std::integral_constant<std::size_t, Stride>,
+                        const void* target) noexcept {
+        const long long s = static_cast<long long>(Stride);
+        __m256i ptrs = _mm256_i64gather_epi64(reinterpret_cast<const long long*>(first),
+                                              _mm256_set_epi64x(3 * s, 2 * s, s, 0), 1);
+        __m256i wanted = _mm256_set1_epi64x(reinterpret_cast<long long>(target));
+        __m256i equal = _mm256_cmpeq_epi64(ptrs, wanted);
+        return static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(equal)));
+    }
+
+    // four packed owners are three loads: the pointers are the words
+    // 0, 3, 6 and 9, blended into one vector instead of gathered
+    inline unsigned scan_equal(const char* first, packed_stride, const void* target) noexcept {
+        __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + 32));
+        __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + 64));
+        // words 0, 9, 6, 3
+        __m256i ptrs = _mm256_blend_epi32(_mm256_blend_epi32(v0, v1, 0x30), v2, 0x0C);
+        ptrs = _mm256_permute4x64_epi64(ptrs, _MM_SHUFFLE(1, 2, 3, 0));
+        __m256i wanted = _mm256_set1_epi64x(reinterpret_cast<long long>(target));
+        __m256i equal = _mm256_cmpeq_epi64(ptrs, wanted);
+        return static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(equal)));
+    }
+#elif defined(LINKED_PTR_SCAN_SIMD)
+    const std::size_t scan_lanes = 2;
+
+    // SSE2 compares 32-bit halves, a pointer is equal if both are
+    inline unsigned equal_mask(__m128i ptrs, const void* target) noexcept {
+        __m128i equal = _mm_cmpeq_epi32(ptrs, _mm_set1_epi64x(reinterpret_cast<long long>(target)));
+        equal = _mm_and_si128(equal, _mm_shuffle_epi32(equal, _MM_SHUFFLE(2, 3, 0, 1)));
+        return static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(equal)));
+    }
+
+    template <std::size_t Stride>
+    unsigned scan_equal(const char* first, std::integral_constant<std::size_t, Stride>,
+                        const void* target) noexcept {
+        long long lo, hi;
+        std::memcpy(&lo, first, sizeof(lo));
+        std::memcpy(&hi, first + Stride, sizeof(hi));
+        return equal_mask(_mm_set_epi64x(hi, lo), target);
+    }
+
+    // two packed owners: the pointers are the words 0 and 3 of two loads
+    inline unsigned scan_equal(const char* first, packed_stride, const void* target) noexcept {
+        __m128d v0 = _mm_loadu_pd(reinterpret_cast<const double*>(first));
+        __m128d v1 = _mm_loadu_pd(reinterpret_cast<const double*>(first + 16));
+        return equal_mask(_mm_castpd_si128(_mm_move_sd(v1, v0)), target);
+    }
+#else
+    const std::size_t scan_lanes = 1;
+
+    template <std::size_t Stride>
+    unsigned scan_equal(const char* first, std::integral_constant<std::size_t, Stride>,
+                        const void* target) noexcept {
+        const void* ptr;
+        std::memcpy(&ptr, first, sizeof(ptr));
+        return ptr == target;
+    }
+#endif
+
+    // the kernels look at four owners at a time whatever the lanes,
+    // like an unrolled loop; bit i of the mask is owner i
+    const std::size_t scan_block = 4;
+
+    template <typename Stride>
+    unsigned scan_equal_block(const char* first, Stride stride, const void* target) noexcept {
+        unsigned mask = 0;
+        for (std::size_t i = 0; i < scan_block; i += scan_lanes)
+            mask |= scan_equal(first + i * Stride::value, stride, target) << i;
+        return mask;
+    }
+
+    inline unsigned lowest_bit(unsigned mask) noexcept {
+#if defined(__GNUC__)
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+        unsigned i = 0;
+        for (; !(mask & 1u); mask >>= 1)
+            ++i;
+        return i;
+#endif
+    }
+
+    // of a block mask; a table, since a popcount may be a library call
+    inline unsigned bit_count(unsigned mask) noexcept {
+        static const unsigned char counts[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+        return counts[mask];
+    }
+
+} // namespace details
+
+// Scans of arrays of owners which compare the object pointers four at
+// a time: with AVX2 at once, with SSE2 two by two, otherwise one by
+// one. The lanes are chosen at compile time. The owners of the default
+// policy are loaded whole and the pointers picked out of the vectors,
+// others are gathered.
+
+/// The first owner of target in [first, last), or last; target is not
+/// deduced, so it may be nullptr or a pointer to a derived class
+template <typename T, typename P>
+const linked_ptr<T, P>* find_pointee(const linked_ptr<T, P>* first, const linked_ptr<T, P>* last,
+                                     const std::common_type_t<T>* target) noexcept {
+    using stride = std::integral_constant<std::size_t, sizeof(*first)>;
+    const std::size_t block = details::scan_block;
+    const std::size_t n = static_cast<std::size_t>(last - first);
+    std::size_t i = 0;
+    for (; i + block <= n; i += block) {
+        const char* bytes = details::pointee_bytes(first + i);
+        unsigned found = details::scan_equal_block(bytes, stride(), target);
+        if (found != 0)
+            return first + i + details::lowest_bit(found);
+    }
+    for (; i < n; ++i) {
+        if (first[i].get() == target)
+            return first + i;
+    }
+    return last;
+}
+
+template <typename T, typename P>
+linked_ptr<T, P>* find_pointee(linked_ptr<T, P>* first, linked_ptr<T, P>* last,
+                               const std::common_type_t<T>* target) noexcept {
+    const linked_ptr<T, P>* begin = first;
+    return first + (find_pointee(begin, last, target) - begin);
+}
+
+/// Number of non-empty owners in [first, last)
+template <typename T, typename P>
+std::size_t count_non_null(const linked_ptr<T, P>* first, const linked_ptr<T, P>* last) noexcept {
+    const std::size_t block = details::scan_block;
+    const std::size_t n = static_cast<std::size_t>(last - first);
+    using stride = std::integral_constant<std::size_t, sizeof(*first)>;
+    std::size_t nulls = 0;
+    std::size_t i = 0;
+    for (; i + block <= n; i += block) {
+        const char* bytes = details::pointee_bytes(first + i);
+        nulls += details::bit_count(details::scan_equal_block(bytes, stride(), nullptr));
+    }
+    for (; i < n; ++i)
+        nulls += !first[i];
+    return n - nulls;
+}
+
+/// Moves the non-empty owners to the front keeping their order, returns
+/// the first empty one. Runs of non-empty owners at the front are not
+/// touched, the others are swapped into place.
+template <typename T, typename P>
+linked_ptr<T, P>* partition_null(linked_ptr<T, P>* first, linked_ptr<T, P>* last) noexcept {
+    const std::size_t block = details::scan_block;
+    const std::size_t n = static_cast<std::size_t>(last - first);
+    using stride = std::integral_constant<std::size_t, sizeof(*first)>;
+    linked_ptr<T, P>* out = first;
+    std::size_t i = 0;
+    for (; i + block <= n; i += block) {
+        const char* bytes = details::pointee_bytes(first + i);
+        unsigned nulls = details::scan_equal_block(bytes, stride(), nullptr);
+        if (nulls == 0 && out == first + i) {
+            out += block;
+            continue;
+        }
+        for (std::size_t k = 0; k < block; ++k) {
+            if (nulls >> k & 1u)
+                continue;
+            if (out != first + i + k)
+                out->swap(first[i + k]);
+            ++out;
+        }
+    }
+    for (; i < n; ++i) {
+        if (!first[i])
+            continue;
+        if (out != first + i)
+            out->swap(first[i]);
+        ++out;
+    }
+    return out;
+}
+
+} // namespace smart_ptr
+
+#endif // LINKED_PTR_SCAN_H
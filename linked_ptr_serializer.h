@@ -0,0 +1,249 @@
+#ifndef LINKED_PTR_SERIALIZER_H
+#define LINKED_PTR_SERIALIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "linked_ptr.h"
+
+namespace smart_ptr {
+
+namespace details {
+
+    // Every owner is written as a tag, followed by the object for a new one.
+    enum serialized_tag : std::uint64_t {
+        null_tag = 0,
+        // the only owner, nothing refers to the object later
+        unique_tag = 1,
+        // the first owner of a shared object, which gets the next id
+        shared_tag = 2,
+        // tag - reference_tag is the id of an object written before
+        reference_tag = 3
+    };
+
+} // namespace details
+
+/// Streaming binary writer of linked_ptr graphs.
+/// A shared object is written once: when its first owner is met, the
+/// whole ring is stamped (every _left is pointed at a stamp holding the
+/// id), so any other owner finds the id with one load instead of a
+/// lookup in an address -> id map. Sole owners need no stamp at all.
+/// The rings are restored by finish() or the destructor, the graph must
+/// not be changed in between.
+class linked_ptr_writer {
+public:
+    explicit linked_ptr_writer(std::ostream& out) : _out(out) {}
+
+    linked_ptr_writer(const linked_ptr_writer&) = delete;
+    linked_ptr_writer& operator=(const linked_ptr_writer&) = delete;
+
+    ~linked_ptr_writer() {
+        finish();
+    }
+
+    /// Writes the owner; write_object(writer, const T&) writes the
+    /// object itself if it was not written before
+    template <typename T, typename Write>
+    void write(const linked_ptr<T>& ptr, Write&& write_object) {
+        if (!ptr) {
+            write_size(details::null_tag);
+            return;
+        }
+
+        details::linked_ptr_base& base = details::linked_ptr_access::base(ptr);
+        if (ptr.unique()) {
+            write_size(details::unique_tag);
+            write_object(*this, *ptr);
+            return;
+        }
+
+        if (base.left()->_right == stamp_marker()) {
+            write_size(details::reference_tag + reinterpret_cast<stamp*>(base.left())->id);
+            return;
+        }
+
+        _stamps.push_back(stamp{{}, _stamps.size(), &base});
+        stamp& s = _stamps.back();
+        s.node._right = stamp_marker();
+        details::linked_ptr_base* current = &base;
+        do {
+            current->set_left(&s.node);
+            current = current->_right;
+        } while (current != &base);
+
+        write_size(details::shared_tag);
+        write_object(*this, *ptr);
+    }
+
+    /// Puts the rings back in order, the graph may be changed afterwards
+    void finish() noexcept {
+        for (stamp& s : _stamps) {
+            details::linked_ptr_base* current = s.first;
+            do {
+                current->_right->set_left(current);
+                current = current->_right;
+            } while (current != s.first);
+        }
+        _stamps.clear();
+    }
+
+    /// Number of shared objects written so far
+    std::size_t shared_count() const noexcept {
+        return _stamps.size();
+    }
+
+    // Primitives for write_object
+
+    void write_size(std::uint64_t value) {
+        char buffer[10];
+        std::size_t size = 0;
+        while (value >= 0x80) {
+            buffer[size++] = static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+        buffer[size++] = static_cast<char>(value);
+        _out.write(buffer, size);
+    }
+
+    template <typename T>
+    void write_value(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values are written as is");
+        _out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void write_string(const std::string& value) {
+        write_size(value.size());
+        _out.write(value.data(), value.size());
+    }
+
+private:
+    struct stamp {
+        // _left of every owner of the ring points here
+        details::linked_ptr_base node;
+        std::size_t id;
+        details::linked_ptr_base* first;
+    };
+
+    // no real node can be the neighbour of a stamp
+    details::linked_ptr_base* stamp_marker() noexcept {
+        return reinterpret_cast<details::linked_ptr_base*>(this);
+    }
+
+    std::ostream& _out;
+    // deque keeps the stamps in place
+    std::deque<stamp> _stamps;
+};
+
+/// Reader of the stream made by linked_ptr_writer.
+/// Owners of an object shared in the stream share it again; the reader
+/// holds one owner of every shared object until it is destroyed.
+class linked_ptr_reader {
+public:
+    explicit linked_ptr_reader(std::istream& in) : _in(in) {}
+
+    linked_ptr_reader(const linked_ptr_reader&) = delete;
+    linked_ptr_reader& operator=(const linked_ptr_reader&) = delete;
+
+    /// read_object(reader) reads the object and returns it allocated with new
+    template <typename T, typename Read>
+    linked_ptr<T> read(Read&& read_object) {
+        std::uint64_t tag = read_size();
+        switch (tag) {
+        case details::null_tag:
+            return linked_ptr<T>();
+        case details::unique_tag:
+            return linked_ptr<T>(read_object(*this));
+        case details::shared_tag: {
+            // reserve the id before the children get theirs
+            std::size_t id = _shared.size();
+            _shared.emplace_back();
+            auto owner = std::make_unique<holder<T>>(read_object(*this));
+            linked_ptr<T> result(owner->ptr);
+            _shared[id] = std::move(owner);
+            return result;
+        }
+        default: {
+            std::uint64_t id = tag - details::reference_tag;
+            if (id >= _shared.size() || !_shared[id] || _shared[id]->type != holder<T>::type())
+                throw std::runtime_error("linked_ptr_reader: bad reference");
+            return static_cast<holder<T>&>(*_shared[id]).ptr;
+        }
+        }
+    }
+
+    /// Drops the owners held by the reader
+    void clear() noexcept {
+        _shared.clear();
+    }
+
+    // Primitives for read_object
+
+    std::uint64_t read_size() {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int byte = _in.get();
+            if (byte == std::char_traits<char>::eof())
+                throw std::runtime_error("linked_ptr_reader: unexpected end of stream");
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+        throw std::runtime_error("linked_ptr_reader: bad size");
+    }
+
+    template <typename T>
+    T read_value() {
+        static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values are read as is");
+        T value;
+        read_bytes(reinterpret_cast<char*>(&value), sizeof(T));
+        return value;
+    }
+
+    std::string read_string() {
+        std::string value(read_size(), '\0');
+        read_bytes(&value[0], value.size());
+        return value;
+    }
+
+private:
+    struct holder_base {
+        explicit holder_base(const void* type) noexcept : type(type) {}
+        virtual ~holder_base() = default;
+
+        const void* type;
+    };
+
+    template <typename T>
+    struct holder : holder_base {
+        template <typename Y>
+        explicit holder(Y* object) : holder_base(type()), ptr(object) {}
+
+        // unique address per type
+        static const void* type() noexcept {
+            static const char key = 0;
+            return &key;
+        }
+
+        linked_ptr<T> ptr;
+    };
+
+    void read_bytes(char* data, std::size_t size) {
+        if (!_in.read(data, size))
+            throw std::runtime_error("linked_ptr_reader: unexpected end of stream");
+    }
+
+    std::istream& _in;
+    std::vector<std::unique_ptr<holder_base>> _shared;
+};
+
+} // namespace smart_ptr
+
+#endif // LINKED_PTR_SERIALIZER_H
@@ -0,0 +1,172 @@
+#ifndef LINKED_PTR_SNAPSHOT_H
+#define LINKED_PTR_SNAPSHOT_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "linked_ptr.h"
+#include "offset_linked_ptr.h"
+
+namespace smart_ptr {
+
+/// Copies a graph of linked_ptr-owned objects into a segment.
+/// Objects shared by several owners are copied once: every owner of
+/// the same ring ends up in one offset_linked_ptr ring in the segment.
+/// The graph has to be acyclic (as any linked_ptr graph that is freed).
+/// The builder holds an owner of its own (in the segment) for every
+/// shared copy, which the others join; finish() or the destructor drop
+/// them, so the segment is saved after that.
+class snapshot_builder {
+public:
+    explicit snapshot_builder(segment& seg) : _segment(seg) {}
+
+    snapshot_builder(const snapshot_builder&) = delete;
+    snapshot_builder& operator=(const snapshot_builder&) = delete;
+
+    ~snapshot_builder() {
+        finish();
+    }
+
+    smart_ptr::segment& get_segment() const noexcept {
+        return _segment;
+    }
+
+    /// Makes dst own the copy of *src. convert(const T&) creates the copy
+    /// in the segment and returns a pointer to it; it may call assign for
+    /// the children of the object. Every assign of an object has to
+    /// convert it to the same type.
+    template <typename U, typename T, typename Convert>
+    void assign(offset_linked_ptr<U>& dst, const linked_ptr<T>& src, Convert&& convert) {
+        if (!src) {
+            dst.reset();
+            return;
+        }
+
+        // the only owner can not be met again, no need to remember it
+        if (src.unique()) {
+            dst.reset(convert(*src));
+            return;
+        }
+
+        using copy_type = std::remove_pointer_t<decltype(convert(*src))>;
+        using anchor_type = offset_linked_ptr<copy_type>;
+        auto it = _copies.find(src.get());
+        if (it == _copies.end()) {
+            // convert may add copies, so it is looked up again
+            anchor_type* anchor = _segment.construct<anchor_type>(convert(*src));
+            it = _copies.emplace(src.get(), shared_copy{anchor, &drop<copy_type>}).first;
+        }
+        assert(it->second.drop == &drop<copy_type>);
+        dst = *static_cast<const anchor_type*>(it->second.anchor);
+    }
+
+    /// Number of shared objects met so far
+    std::size_t shared_count() const noexcept {
+        return _copies.size();
+    }
+
+    /// Drops the owners of the builder; a copy nobody else owns any more
+    /// is destroyed
+    void finish() noexcept {
+        for (auto& entry : _copies)
+            entry.second.drop(entry.second.anchor);
+        _copies.clear();
+    }
+
+private:
+    // the owner of the builder, an offset_linked_ptr in the segment
+    struct shared_copy {
+        void* anchor;
+        void (*drop)(void*);
+    };
+
+    template <typename C>
+    static void drop(void* anchor) noexcept {
+        static_cast<offset_linked_ptr<C>*>(anchor)->~offset_linked_ptr();
+    }
+
+    smart_ptr::segment& _segment;
+    // pointee of a shared ring -> owner of its copy
+    std::unordered_map<const void*, shared_copy> _copies;
+};
+
+/// Writes the used part of the segment to a file
+inline bool save_snapshot(const segment& seg, const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+    bool ok = std::fwrite(seg.data(), 1, seg.used(), file) == seg.used();
+    return std::fclose(file) == 0 && ok;
+}
+
+/// Snapshot file mapped into memory. All links in a segment are
+/// relative, so the graph is usable right after mmap: there is nothing
+/// to fix up and pages are only read in when touched.
+/// The mapping is private: changes (e.g. new owners joining rings)
+/// never reach the file.
+class mapped_snapshot {
+public:
+    mapped_snapshot() noexcept = default;
+
+    explicit mapped_snapshot(const std::string& path) noexcept {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+            std::size_t size = static_cast<std::size_t>(info.st_size);
+            void* region = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (region != MAP_FAILED) {
+                _segment = segment::attach(region, size);
+                if (_segment) {
+                    _region = region;
+                    _size = size;
+                } else {
+                    ::munmap(region, size);
+                }
+            }
+        }
+        ::close(fd);
+    }
+
+    mapped_snapshot(const mapped_snapshot&) = delete;
+    mapped_snapshot& operator=(const mapped_snapshot&) = delete;
+
+    ~mapped_snapshot() {
+        if (_region != nullptr)
+            ::munmap(_region, _size);
+    }
+
+    explicit operator bool() const noexcept {
+        return _region != nullptr;
+    }
+
+    const smart_ptr::segment& get_segment() const noexcept {
+        return _segment;
+    }
+
+    template <typename T>
+    T* root() const noexcept {
+        return _segment.root<T>();
+    }
+
+private:
+    void* _region = nullptr;
+    std::size_t _size = 0;
+    smart_ptr::segment _segment;
+};
+
+} // namespace smart_ptr
+
+#endif // LINKED_PTR_SNAPSHOT_H
@@ -0,0 +1,297 @@
+#ifndef LINKED_PTR_STATS_H
+#define LINKED_PTR_STATS_H
+
+// Ownership statistics per element_type, included by linked_ptr.h when
+// LINKED_PTR_STATS is defined.
+//
+// Every thread counts into its own block of relaxed atomics (plain loads
+// and stores on the owning thread), blocks are summed when a snapshot is
+// taken. A finished thread moves its counts to a block shared by the
+// finished threads, which also takes what its last owners count. Ring
+// lengths are measured on one copy out of sampling_period().
+// An object is counted under the element_type of the owner that took it
+// and uncounted under the one that deleted it.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
+namespace smart_ptr {
+
+namespace stats {
+
+    struct type_stats {
+        std::string type;
+        std::int64_t live_objects;
+        std::int64_t live_owners;
+        std::int64_t bytes_owned;
+        // longest ring met by the sampled copies
+        std::size_t peak_ring_length;
+    };
+
+} // namespace stats
+
+namespace details {
+
+    class stats_registry {
+    public:
+        // types beyond it share the last slot
+        static constexpr std::size_t max_types = 512;
+
+        struct counters {
+            std::atomic<std::int64_t> objects{0};
+            std::atomic<std::int64_t> owners{0};
+            std::atomic<std::int64_t> bytes{0};
+        };
+
+        struct thread_block {
+            counters types[max_types];
+            std::size_t copies_since_sample = 0;
+            // the block of the finished threads, written by several
+            bool shared = false;
+
+            // a plain load and store on the owning thread
+            void add(std::atomic<std::int64_t>& counter, std::int64_t delta) noexcept {
+                if (shared)
+                    counter.fetch_add(delta, std::memory_order_relaxed);
+                else
+                    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+            }
+        };
+
+        static stats_registry& instance() noexcept {
+            // never destroyed, owners with static storage may outlive main
+            static stats_registry* registry = new stats_registry;
+            return *registry;
+        }
+
+        std::size_t register_type(const char* mangled) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_names.size() == max_types - 1)
+                _names.push_back("<other types>");
+            if (_names.size() >= max_types)
+                return max_types - 1;
+            _names.push_back(demangle(mangled));
+            return _names.size() - 1;
+        }
+
+        // blocks are never freed: a finished thread moves its counts to
+        // the shared block and its own block goes to the next new thread
+        thread_block* attach() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_free.empty()) {
+                thread_block* block = _free.back();
+                _free.pop_back();
+                return block;
+            }
+            _blocks.push_back(std::make_unique<thread_block>());
+            return _blocks.back().get();
+        }
+
+        // returns the block to count into for the rest of the thread
+        thread_block* detach(thread_block* block) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (std::size_t i = 0; i < _names.size(); ++i) {
+                counters& from = block->types[i];
+                counters& to = _finished->types[i];
+                to.objects.fetch_add(from.objects.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+                to.owners.fetch_add(from.owners.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+                to.bytes.fetch_add(from.bytes.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            block->copies_since_sample = 0;
+            _free.push_back(block);
+            return _finished.get();
+        }
+
+        void update_peak(std::size_t type, std::size_t length) noexcept {
+            std::size_t peak = _peaks[type].load(std::memory_order_relaxed);
+            while (peak < length && !_peaks[type].compare_exchange_weak(peak, length, std::memory_order_relaxed)) {}
+        }
+
+        std::size_t sampling_period() const noexcept {
+            return _sampling_period.load(std::memory_order_relaxed);
+        }
+
+        void set_sampling_period(std::size_t period) noexcept {
+            _sampling_period.store(period == 0 ? 1 : period, std::memory_order_relaxed);
+        }
+
+        std::vector<stats::type_stats> snapshot() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::vector<stats::type_stats> result;
+            for (std::size_t i = 0; i < _names.size(); ++i) {
+                counters total;
+                for (auto const& block : _blocks)
+                    add(total, block->types[i]);
+                add(total, _finished->types[i]);
+                result.push_back({_names[i], total.objects.load(), total.owners.load(), total.bytes.load(),
+                                  _peaks[i].load(std::memory_order_relaxed)});
+            }
+            return result;
+        }
+
+    private:
+        stats_registry() : _finished(std::make_unique<thread_block>()) {
+            _finished->shared = true;
+        }
+
+        static void add(counters& to, const counters& from) noexcept {
+            to.objects.store(to.objects.load(std::memory_order_relaxed) + from.objects.load(std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+            to.owners.store(to.owners.load(std::memory_order_relaxed) + from.owners.load(std::memory_order_relaxed),
+                            std::memory_order_relaxed);
+            to.bytes.store(to.bytes.load(std::memory_order_relaxed) + from.bytes.load(std::memory_order_relaxed),
+                           std::memory_order_relaxed);
+        }
+
+        static std::string demangle(const char* mangled) {
+#if defined(__GNUG__)
+            int status = 0;
+            char* name = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+            if (status == 0 && name != nullptr) {
+                std::string result(name);
+                std::free(name);
+                return result;
+            }
+#endif
+            return mangled;
+        }
+
+        std::mutex _mutex;
+        std::vector<std::string> _names;
+        std::vector<std::unique_ptr<thread_block>> _blocks;
+        std::vector<thread_block*> _free;
+        std::unique_ptr<thread_block> _finished;
+        std::atomic<std::size_t> _peaks[max_types] = {};
+        std::atomic<std::size_t> _sampling_period{64};
+    };
+
+    // the block of this thread; stays valid after stats_thread is
+    // destroyed, for owners destroyed later on the same thread
+    inline stats_registry::thread_block*& stats_block_slot() noexcept {
+        thread_local stats_registry::thread_block* block = nullptr;
+        return block;
+    }
+
+    // gives the block back when the thread finishes
+    struct stats_thread {
+        ~stats_thread() {
+            stats_block_slot() = stats_registry::instance().detach(block);
+        }
+
+        stats_registry::thread_block* block;
+    };
+
+    inline stats_registry::thread_block& stats_block() {
+        stats_registry::thread_block*& block = stats_block_slot();
+        if (block == nullptr) {
+            block = stats_registry::instance().attach();
+            thread_local stats_thread thread{block};
+        }
+        return *block;
+    }
+
+    template <typename T>
+    std::size_t stats_type_id() {
+        static const std::size_t id = stats_registry::instance().register_type(typeid(T).name());
+        return id;
+    }
+
+    template <typename T>
+    void stats_acquire(const T* ptr) noexcept {
+        if (ptr == nullptr)
+            return;
+        stats_registry::thread_block& block = stats_block();
+        stats_registry::counters& c = block.types[stats_type_id<std::remove_cv_t<T>>()];
+        block.add(c.objects, 1);
+        block.add(c.owners, 1);
+        block.add(c.bytes, sizeof(T));
+    }
+
+    template <typename T, typename Node>
+    void stats_copy(const T* ptr, const Node& node) noexcept {
+        if (ptr == nullptr)
+            return;
+        stats_registry::thread_block& block = stats_block();
+        std::size_t type = stats_type_id<std::remove_cv_t<T>>();
+        block.add(block.types[type].owners, 1);
+
+        // the sampling count of the shared block would be a race
+        stats_registry& registry = stats_registry::instance();
+        if (block.shared || ++block.copies_since_sample < registry.sampling_period())
+            return;
+        block.copies_since_sample = 0;
+        std::size_t length = 1;
+        for (auto current = node._right; current != &node; current = current->_right)
+            ++length;
+        registry.update_peak(type, length);
+    }
+
+    template <typename T>
+    void stats_release(const T* ptr, bool last) noexcept {
+        if (ptr == nullptr)
+            return;
+        stats_registry::thread_block& block = stats_block();
+        stats_registry::counters& c = block.types[stats_type_id<std::remove_cv_t<T>>()];
+        block.add(c.owners, -1);
+        if (last) {
+            block.add(c.objects, -1);
+            block.add(c.bytes, -static_cast<std::int64_t>(sizeof(T)));
+        }
+    }
+
+} // namespace details
+
+namespace stats {
+
+    /// Current totals of every type met so far
+    inline std::vector<type_stats> snapshot() {
+        return details::stats_registry::instance().snapshot();
+    }
+
+    /// The ring length is measured on one copy out of period
+    inline void set_sampling_period(std::size_t period) noexcept {
+        details::stats_registry::instance().set_sampling_period(period);
+    }
+
+    inline void dump_json(std::ostream& out, const std::vector<type_stats>& types) {
+        out << "[";
+        for (std::size_t i = 0; i < types.size(); ++i) {
+            const type_stats& t = types[i];
+            out << (i ? "," : "") << "{\"type\":\"";
+            for (char c : t.type) {
+                if (c == '"' || c == '\\')
+                    out << '\\';
+                out << c;
+            }
+            out << "\",\"live_objects\":" << t.live_objects << ",\"live_owners\":" << t.live_owners
+                << ",\"bytes_owned\":" << t.bytes_owned << ",\"peak_ring_length\":" << t.peak_ring_length << "}";
+        }
+        out << "]";
+    }
+
+    inline std::string to_json() {
+        std::ostringstream out;
+        dump_json(out, snapshot());
+        return out.str();
+    }
+
+} // namespace stats
+
+} // namespace smart_ptr
+
+#endif // LINKED_PTR_STATS_H
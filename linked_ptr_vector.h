@@ -0,0 +1,119 @@
+#ifndef LINKED_PTR_VECTOR_H
+#define LINKED_PTR_VECTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "linked_ptr.h"
+
+namespace smart_ptr {
+
+/// Vector of linked_ptr which releases its elements with destroy_range:
+/// clearing or destroying a large vector unlinks the owners that are ring
+/// neighbours in it as a group instead of one by one, and fills it with
+/// clone_into.
+template <typename T>
+class linked_ptr_vector {
+public:
+    using value_type = linked_ptr<T>;
+    using iterator = typename std::vector<linked_ptr<T>>::iterator;
+    using const_iterator = typename std::vector<linked_ptr<T>>::const_iterator;
+
+    linked_ptr_vector() noexcept = default;
+
+    explicit linked_ptr_vector(std::size_t size) : _items(size) {}
+
+    linked_ptr_vector(std::size_t size, const linked_ptr<T>& value) : _items(size) {
+        value.clone_into(_items.begin(), _items.end());
+    }
+
+    linked_ptr_vector(const linked_ptr_vector&) = default;
+
+    linked_ptr_vector(linked_ptr_vector&& other) noexcept : _items(std::move(other._items)) {}
+
+    linked_ptr_vector& operator=(linked_ptr_vector other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~linked_ptr_vector() {
+        clear();
+    }
+
+    // Info
+
+    std::size_t size() const noexcept {
+        return _items.size();
+    }
+
+    bool empty() const noexcept {
+        return _items.empty();
+    }
+
+    linked_ptr<T>& operator[](std::size_t i) noexcept {
+        return _items[i];
+    }
+
+    const linked_ptr<T>& operator[](std::size_t i) const noexcept {
+        return _items[i];
+    }
+
+    linked_ptr<T>* data() noexcept {
+        return _items.data();
+    }
+
+    iterator begin() noexcept {
+        return _items.begin();
+    }
+
+    iterator end() noexcept {
+        return _items.end();
+    }
+
+    const_iterator begin() const noexcept {
+        return _items.begin();
+    }
+
+    const_iterator end() const noexcept {
+        return _items.end();
+    }
+
+    // Modification
+
+    void reserve(std::size_t capacity) {
+        _items.reserve(capacity);
+    }
+
+    void push_back(const linked_ptr<T>& value) {
+        _items.push_back(value);
+    }
+
+    void pop_back() noexcept {
+        _items.pop_back();
+    }
+
+    void clear() noexcept {
+        // from the back, a block at a time, so that the destructors
+        // find the released elements still in the cache
+        const std::size_t block = 1024;
+        while (!_items.empty()) {
+            std::size_t n = std::min(block, _items.size());
+            linked_ptr<T>* end = _items.data() + _items.size();
+            destroy_range(end - n, end);
+            _items.erase(_items.end() - n, _items.end());
+        }
+    }
+
+    void swap(linked_ptr_vector& other) noexcept {
+        _items.swap(other._items);
+    }
+
+private:
+    std::vector<linked_ptr<T>> _items;
+};
+
+} // namespace smart_ptr
+
+#endif // LINKED_PTR_VECTOR_H
@@ -1,11 +1,41 @@
 #include <iostream>
 #include <memory>
+#include <new>
 #include <algorithm>
+#include <atomic>
 #include <set>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include "linked_ptr.h"
+#include "offset_linked_ptr.h"
+#include "linked_ptr_snapshot.h"
+#include "linked_ptr_serializer.h"
+#include "linked_cache.h"
+#include "linked_interner.h"
+#include "cow.h"
+#include "persistent_vector.h"
+#include "persistent_map.h"
+#include "linked_buffer.h"
+#include "mapped_file.h"
+#include "message_bus.h"
+#include "linked_ptr_vector.h"
+#include "linked_ptr_arena.h"
+#include "handoff_queue.h"
+#include "sharded_ptr.h"
+#include "linked_ptr_flat_set.h"
+#include "linked_ptr_scan.h"
 
 using namespace smart_ptr;
 using std::cout;
@@ -51,6 +81,8 @@ bool del_test() {
 
     check *= !v2ptr.unique();
     vptr.~linked_ptr<std::vector<int>>();
+    // vptr is destroyed again at the end of the scope, so it needs an object
+    new (&vptr) linked_ptr<std::vector<int>>();
     std::vector<int> v = *v2ptr;
     check *= (v[0] == 1);
     check *= v2ptr.unique();
@@ -193,6 +225,1074 @@ bool test_swap() {
     return is_a_deleted && !is_b_deleted;
 }
 
+struct shm_node {
+    explicit shm_node(int value) : value(value) {}
+
+    int value;
+    offset_linked_ptr<shm_node> next;
+};
+
+bool offset_test() {
+    cout << "start: offset_test" << endl;
+    bool check = true;
+
+    const std::size_t size = 1 << 16;
+    char path[] = "/tmp/linked_ptr_shmXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || ftruncate(fd, size) != 0)
+        return false;
+    unlink(path);
+
+    void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (region == MAP_FAILED)
+        return false;
+
+    // 1 -> 2 -> 3, node 2 is also held by extra
+    segment seg = segment::create(region, size);
+    auto* head = seg.construct<offset_linked_ptr<shm_node>>(seg.construct<shm_node>(1));
+    (*head)->next.reset(seg.construct<shm_node>(2));
+    (*head)->next->next.reset(seg.construct<shm_node>(3));
+    auto* extra = seg.construct<offset_linked_ptr<shm_node>>((*head)->next);
+    seg.set_root(head);
+
+    check *= !extra->unique() && *extra == (*head)->next;
+
+    // a region that is not a segment attaches as an invalid one, without root
+    alignas(std::max_align_t) char junk[256] = {};
+    check *= !segment::attach(junk) && segment::attach(junk).root<shm_node>() == nullptr;
+
+    // a limited attachment leaves the shared header alone
+    segment limited = segment::attach(region, size / 2);
+    check *= limited && limited.capacity() == size / 2 && !limited.contains(static_cast<char*>(region) + size / 2);
+    check *= segment::attach(region).capacity() == size && seg.capacity() == size;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        // the first mapping is still there, so this one lands elsewhere
+        void* other = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (other == MAP_FAILED || other == region)
+            _exit(2);
+        segment child = segment::attach(other);
+        auto* root = child.root<offset_linked_ptr<shm_node>>();
+        bool ok = child && root && (*root)->value == 1
+                  && (*root)->next->value == 2 && (*root)->next->next->value == 3
+                  && !(*root)->next.unique() && (*root)->next->next.unique();
+        // join the ring of the head through the second mapping
+        child.construct<offset_linked_ptr<shm_node>>(*root);
+        _exit(ok ? 0 : 1);
+    }
+
+    int status = 0;
+    check *= pid > 0 && waitpid(pid, &status, 0) == pid;
+    check *= WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    check *= !head->unique();
+
+    extra->reset();
+    check *= (*head)->next.unique();
+
+    // stepping a sole owner along a list assigns from inside its own pointee
+    auto* walk = seg.construct<offset_linked_ptr<shm_node>>(seg.construct<shm_node>(4));
+    (*walk)->next.reset(seg.construct<shm_node>(5));
+    (*walk)->next->next.reset(seg.construct<shm_node>(6));
+    *walk = (*walk)->next;
+    check *= walk->unique() && (*walk)->value == 5;
+    check *= (*walk)->next && (*walk)->next->value == 6 && (*walk)->next.unique();
+
+    munmap(region, size);
+    close(fd);
+    return check;
+}
+
+struct graph_node {
+    graph_node(int value, const linked_ptr<graph_node>& left, const linked_ptr<graph_node>& right)
+            : value(value), left(left), right(right) {}
+
+    int value;
+    linked_ptr<graph_node> left;
+    linked_ptr<graph_node> right;
+};
+
+struct snap_node {
+    explicit snap_node(int value) : value(value) {}
+
+    int value;
+    offset_linked_ptr<snap_node> left;
+    offset_linked_ptr<snap_node> right;
+};
+
+snap_node* copy_node(snapshot_builder& builder, const graph_node& node) {
+    auto* copy = builder.get_segment().construct<snap_node>(node.value);
+    auto convert = [&builder](const graph_node& child) { return copy_node(builder, child); };
+    builder.assign(copy->left, node.left, convert);
+    builder.assign(copy->right, node.right, convert);
+    return copy;
+}
+
+bool snapshot_test() {
+    cout << "start: snapshot_test" << endl;
+    bool check = true;
+
+    linked_ptr<graph_node> none;
+    linked_ptr<graph_node> shared(new graph_node(3, none, none));
+    linked_ptr<graph_node> left(new graph_node(1, shared, none));
+    linked_ptr<graph_node> root(new graph_node(0, left, shared));
+
+    std::vector<char> memory(1 << 12);
+    segment seg = segment::create(memory.data(), memory.size());
+    snapshot_builder builder(seg);
+    auto* snap_root = seg.construct<offset_linked_ptr<snap_node>>();
+    builder.assign(*snap_root, root, [&builder](const graph_node& node) { return copy_node(builder, node); });
+    seg.set_root(snap_root);
+    check *= builder.shared_count() == 2;
+    builder.finish();
+
+    char path[] = "/tmp/linked_ptr_snapXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return false;
+    close(fd);
+    check *= save_snapshot(seg, path);
+
+    {
+        mapped_snapshot snapshot(path);
+        auto* loaded = snapshot ? snapshot.root<offset_linked_ptr<snap_node>>() : nullptr;
+        check *= loaded != nullptr;
+        if (loaded != nullptr) {
+            const snap_node& node = **loaded;
+            check *= node.value == 0 && node.left->value == 1 && node.right->value == 3;
+            check *= node.left->left == node.right;
+            check *= !node.right.unique() && !node.left->right;
+        }
+    }
+
+    unlink(path);
+
+    // the first owner of a copy is released before the object is met again
+    std::vector<char> other_memory(1 << 12);
+    segment other = segment::create(other_memory.data(), other_memory.size());
+    snapshot_builder other_builder(other);
+    auto convert = [&other_builder](const graph_node& node) { return copy_node(other_builder, node); };
+    auto* first = other.construct<offset_linked_ptr<snap_node>>();
+    auto* second = other.construct<offset_linked_ptr<snap_node>>();
+    other_builder.assign(*first, shared, convert);
+    first->reset();
+    other_builder.assign(*second, shared, convert);
+    check *= *second && (*second)->value == 3 && !second->unique() && other_builder.shared_count() == 1;
+    other_builder.finish();
+    check *= second->unique();
+    return check;
+}
+
+bool assign_test() {
+    cout << "start: assign_test" << endl;
+    bool check = true;
+
+    bool is_a_deleted = false;
+    bool is_b_deleted = false;
+    linked_ptr<is_deleted> a1(new is_deleted(is_a_deleted));
+    linked_ptr<is_deleted> a2(a1);
+    linked_ptr<is_deleted> b1(new is_deleted(is_b_deleted));
+
+    a2 = b1;
+    check *= a1.unique() && !b1.unique() && a2 == b1;
+    a2 = a2;
+    check *= !a2.unique() && a2 == b1;
+
+    // unique owner swapped with a ring member
+    linked_ptr<is_deleted> c;
+    c.swap(b1);
+    check *= b1.unique() && !b1 && !c.unique() && c == a2;
+
+    a1 = c;
+    check *= is_a_deleted && !is_b_deleted;
+    a1.reset();
+    a2.reset();
+    c.reset();
+    check *= is_b_deleted;
+
+    // the right side is owned by the object being released
+    linked_ptr<graph_node> none;
+    linked_ptr<graph_node> last(new graph_node(2, none, none));
+    linked_ptr<graph_node> list(new graph_node(1, last, none));
+    last.reset();
+    list = list->left;
+    check *= list->value == 2 && list.unique();
+
+    // ring member swapped with a unique owner, and owners of two rings
+    linked_ptr<int> x1(new int(1));
+    linked_ptr<int> x2(x1);
+    linked_ptr<int> x3(x1);
+    linked_ptr<int> y1(new int(2));
+    linked_ptr<int> y2(y1);
+    linked_ptr<int> z(new int(3));
+    x2.swap(z);
+    check *= *x2 == 3 && x2.unique() && *z == 1 && !z.unique();
+    x3.swap(y2);
+    check *= *x3 == 2 && *y2 == 1 && x3 == y1 && y2 == x1 && y2 == z;
+    x1.reset();
+    z.reset();
+    check *= y2.unique() && !y1.unique();
+
+    // converting assignment and assigning an empty owner
+    linked_ptr<B> derived(new B());
+    linked_ptr<A> base(new A());
+    linked_ptr<A> other(base);
+    base = derived;
+    check *= base->a == 1 && !derived.unique() && other.unique() && other->a == 0;
+    other = linked_ptr<A>();
+    base = other;
+    check *= !other && !base && derived.unique();
+    return check;
+}
+
+void write_graph_node(linked_ptr_writer& writer, const graph_node& node) {
+    writer.write_value(node.value);
+    writer.write(node.left, write_graph_node);
+    writer.write(node.right, write_graph_node);
+}
+
+graph_node* read_graph_node(linked_ptr_reader& reader) {
+    int value = reader.read_value<int>();
+    linked_ptr<graph_node> left = reader.read<graph_node>(read_graph_node);
+    linked_ptr<graph_node> right = reader.read<graph_node>(read_graph_node);
+    return new graph_node(value, left, right);
+}
+
+bool serializer_test() {
+    cout << "start: serializer_test" << endl;
+    bool check = true;
+
+    linked_ptr<graph_node> none;
+    linked_ptr<graph_node> shared(new graph_node(3, none, none));
+    linked_ptr<graph_node> left(new graph_node(1, shared, shared));
+    linked_ptr<graph_node> root(new graph_node(0, left, shared));
+    left.reset();
+    shared.reset();
+
+    std::stringstream stream;
+    {
+        linked_ptr_writer writer(stream);
+        writer.write(root, write_graph_node);
+        check *= writer.shared_count() == 1;
+    }
+    // the rings are back in order
+    check *= !root->right.unique() && root->left.unique();
+    linked_ptr<graph_node> copy(root->right);
+    copy.reset();
+
+    linked_ptr<graph_node> loaded;
+    {
+        linked_ptr_reader reader(stream);
+        loaded = reader.read<graph_node>(read_graph_node);
+    }
+    check *= loaded->value == 0 && loaded->left->value == 1 && loaded->right->value == 3;
+    check *= loaded->left->left == loaded->right && loaded->left->right == loaded->right;
+    check *= loaded->right != root->right && loaded.unique() && loaded->left.unique();
+    return check;
+}
+
+#ifdef LINKED_PTR_DEBUG
+bool debug_test() {
+    cout << "start: debug_test" << endl;
+    bool check = true;
+
+    std::size_t live = details::live_rings().size();
+    linked_ptr<A> p1(new B());
+    linked_ptr<A> p2(p1);
+    check *= details::live_rings().size() == live + 1;
+    p1.reset(new A());
+    check *= details::live_rings().size() == live + 2;
+    p2 = p1;
+    check *= details::live_rings().size() == live + 1;
+    p1.reset();
+    p2.reset();
+    check *= details::live_rings().size() == live;
+    return check;
+}
+#endif
+
+#ifdef LINKED_PTR_THREAD_CHECK
+bool thread_check_test() {
+    cout << "start: thread_check_test" << endl;
+    bool check = true;
+
+    // the thread is kept in the links, an owner stays three pointers
+    check *= sizeof(linked_ptr<int>) == 3 * sizeof(void*);
+
+    // an owner moved to a thread through handoff_queue is its to copy
+    handoff_queue<int> queue(4);
+    linked_ptr<int> sent(new int(1));
+    check *= queue.try_push(sent);
+    bool copied = false;
+    std::thread([&] {
+        linked_ptr<int> received;
+        linked_ptr<int> copy;
+        copied = queue.try_pop(received) && (copy = received, !copy.unique());
+    }).join();
+    check *= copied;
+
+    // the rings of global_lock are not confined
+    using locked_ptr = linked_ptr<int, linked_ptr_policy<default_deleter, global_lock>>;
+    locked_ptr locked(new int(3));
+    std::thread([&] { locked_ptr copy(locked); }).join();
+    check *= locked.unique();
+
+    // a copy from another thread aborts
+    linked_ptr<int> shared(new int(2));
+    pid_t pid = fork();
+    if (pid == 0) {
+        std::thread([&] { linked_ptr<int> copy(shared); }).join();
+        _exit(0);
+    }
+    int status = 0;
+    check *= pid > 0 && waitpid(pid, &status, 0) == pid;
+    check *= WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+    return check;
+}
+#endif
+
+#ifdef LINKED_PTR_STATS
+struct stats_probe {
+    int data[4];
+};
+
+bool stats_test() {
+    cout << "start: stats_test" << endl;
+    bool check = true;
+
+    auto find = [] {
+        for (auto const& t : stats::snapshot())
+            if (t.type == "stats_probe")
+                return t;
+        return stats::type_stats{"", -1, -1, -1, 0};
+    };
+
+    stats::set_sampling_period(1);
+    linked_ptr<stats_probe> p1(new stats_probe());
+    linked_ptr<stats_probe> p2(p1);
+    linked_ptr<stats_probe> p3(p2);
+    stats::type_stats t = find();
+    check *= t.live_objects == 1 && t.live_owners == 3;
+    check *= t.bytes_owned == sizeof(stats_probe) && t.peak_ring_length == 3;
+
+    p1.reset();
+    p2.reset(new stats_probe());
+    t = find();
+    check *= t.live_objects == 2 && t.live_owners == 2;
+    check *= stats::to_json().find("{\"type\":\"stats_probe\",\"live_objects\":2,") != std::string::npos;
+
+    p2.reset();
+    p3.reset();
+    t = find();
+    check *= t.live_objects == 0 && t.live_owners == 0 && t.bytes_owned == 0;
+
+    // the bulk operations keep the counts
+    linked_ptr<stats_probe> array[4];
+    linked_ptr<stats_probe>(new stats_probe()).clone_into(array, array + 4);
+    t = find();
+    check *= t.live_objects == 1 && t.live_owners == 4;
+    destroy_range(array, array + 4);
+    t = find();
+    check *= t.live_objects == 0 && t.live_owners == 0;
+
+    // made before the block of its thread, so released after the thread
+    // gave the block back; the next thread gets the block
+    for (int i = 0; i < 2; ++i) {
+        std::thread([] {
+            thread_local linked_ptr<stats_probe> late;
+            late.reset(new stats_probe());
+        }).join();
+    }
+    std::thread([] { linked_ptr<stats_probe> p(new stats_probe()); }).join();
+    t = find();
+    check *= t.live_objects == 0 && t.live_owners == 0 && t.bytes_owned == 0;
+    return check;
+}
+#endif
+
+struct unit_size {
+    std::size_t operator()(int) const noexcept {
+        return 1;
+    }
+};
+
+bool cache_test() {
+    cout << "start: cache_test" << endl;
+    bool check = true;
+
+    // room for four ints in one shard
+    linked_cache<int, int> cache(4 * sizeof(int), 1);
+    for (int i = 0; i < 4; ++i)
+        cache.put(i, linked_ptr<int>(new int(i)));
+    check *= cache.size() == 4 && cache.bytes() == 4 * sizeof(int);
+
+    // 0 is used outside, 1 was used lately
+    linked_ptr<int> held = cache.get(0);
+    check *= held && *held == 0 && !held.unique();
+    check *= *cache.get(1) == 1;
+
+    cache.put(4, linked_ptr<int>(new int(4)));
+    check *= cache.size() == 4 && cache.contains(0) && cache.contains(1) && !cache.contains(2);
+
+    for (int i = 5; i < 20; ++i)
+        cache.put(i, linked_ptr<int>(new int(i)));
+    check *= cache.size() == 4 && cache.contains(0) && *held == 0;
+
+    // everything is held outside: the cache goes over capacity
+    std::vector<linked_ptr<int>> all;
+    for (int i = 20; i < 30; ++i) {
+        all.push_back(linked_ptr<int>(new int(i)));
+        cache.put(i, all.back());
+    }
+    check *= cache.contains(0) && cache.contains(20) && cache.contains(29);
+    // the scans stopped; replacing an entry evicts the released ones
+    all.clear();
+    held.reset();
+    cache.put(29, linked_ptr<int>(new int(29)));
+    check *= cache.size() == 4 && cache.bytes() <= cache.capacity();
+    cache.shrink();
+    check *= cache.size() == 4 && cache.bytes() <= cache.capacity();
+    bool erased = cache.erase(29);
+    check *= erased != cache.contains(29);
+
+    // fewer units of capacity than shards: every entry still has room
+    linked_cache<int, int, std::hash<int>, unit_size> small(5);
+    for (int i = 0; i < 5; ++i)
+        small.put(i, linked_ptr<int>(new int(i)));
+    check *= small.size() == 5 && small.bytes() == small.capacity();
+    small.put(5, linked_ptr<int>(new int(5)));
+    check *= small.size() == 5 && small.contains(5);
+    return check;
+}
+
+bool interner_test() {
+    cout << "start: interner_test" << endl;
+    bool check = true;
+
+    linked_interner<std::string> pool(4);
+    linked_ptr<const std::string> a = pool.intern("alpha");
+    linked_ptr<const std::string> b = pool.intern(std::string("al") + "pha");
+    linked_ptr<const std::string> c = pool.intern("beta");
+    check *= a == b && a != c && *c == "beta" && pool.size() == 2;
+
+    c.reset();
+    check *= pool.sweep_all() == 1 && pool.size() == 1;
+
+    // unowned entries go away while interning other values
+    std::vector<linked_ptr<const std::string>> held;
+    for (int i = 0; i < 1000; ++i) {
+        linked_ptr<const std::string> s = pool.intern(std::to_string(i % 100));
+        if (i < 100)
+            held.push_back(s);
+    }
+    check *= pool.size() == 101;
+    for (int i = 0; i < 100; ++i)
+        check *= pool.intern(std::to_string(i)) == held[i];
+
+    held.resize(10);
+    pool.sweep_all();
+    check *= pool.size() == 11 && *pool.intern("alpha") == "alpha" && pool.intern("alpha") == a;
+    return check;
+}
+
+bool cow_test() {
+    cout << "start: cow_test" << endl;
+    bool check = true;
+
+    cow<std::vector<int>> a(std::vector<int>{1, 2, 3});
+    cow<std::vector<int>> b = a;
+    check *= a.shared() && b.shared() && &*a == &*b;
+
+    b.write().push_back(4);
+    check *= !a.shared() && !b.shared() && a->size() == 3 && b->size() == 4;
+
+    // the only owner writes in place
+    const std::vector<int>* before = &*b;
+    b.write()[0] = 0;
+    check *= &*b == before && (*b)[0] == 0 && a.get()[0] == 1;
+
+    cow<std::vector<int>> c(a);
+    c = b;
+    check *= !a.shared() && c.shared() && c == b && c != a;
+    return check;
+}
+
+bool persistent_vector_test() {
+    cout << "start: persistent_vector_test" << endl;
+    bool check = true;
+
+    persistent_vector<int> v;
+    for (int i = 0; i < 1500; ++i)
+        v.push_back(i);
+    persistent_vector<int> snapshot = v;
+    check *= snapshot.size() == 1500 && snapshot[1024] == 1024;
+
+    for (int i = 0; i < 3000; ++i)
+        v.push_back(1500 + i);
+    for (std::size_t i = 0; i < v.size(); i += 7)
+        v.set(i, -static_cast<int>(i));
+    check *= v.size() == 4500 && v[7] == -7 && v[8] == 8 && v[4494] == -4494 && v.back() == 4499;
+    check *= snapshot.size() == 1500 && snapshot[7] == 7 && snapshot.back() == 1499;
+
+    // snapshot-free changes stay in place
+    persistent_vector<int> other = snapshot;
+    other.set(0, 100);
+    const int* before = &other[0];
+    other.set(0, 200);
+    check *= &other[0] == before && other[0] == 200 && snapshot[0] == 0;
+
+    while (v.size() > 1000)
+        v.pop_back();
+    check *= v.size() == 1000 && v.back() == 999 && v[994] == -994;
+    while (!snapshot.empty())
+        snapshot.pop_back();
+    check *= other.size() == 1500 && other.back() == 1499;
+    snapshot.push_back(1);
+    check *= snapshot.size() == 1 && snapshot[0] == 1;
+    return check;
+}
+
+struct colliding_hash {
+    std::size_t operator()(int key) const noexcept {
+        return static_cast<std::size_t>(key % 4);
+    }
+};
+
+template <typename Map>
+bool persistent_map_check() {
+    bool check = true;
+
+    Map m;
+    for (int i = 0; i < 2000; ++i)
+        check *= m.insert_or_assign(i, i * 2);
+    Map snapshot = m;
+    check *= !m.insert_or_assign(5, -5) && m.size() == 2000;
+
+    for (int i = 0; i < 2000; i += 2)
+        check *= m.erase(i);
+    check *= !m.erase(0) && m.size() == 1000;
+    check *= !m.contains(4) && *m.find(5) == -5 && *m.find(1999) == 3998;
+    check *= snapshot.size() == 2000 && *snapshot.find(4) == 8 && *snapshot.find(5) == 10;
+
+    long sum = 0;
+    snapshot.for_each([&sum](int, int value) { sum += value; });
+    check *= sum == 1999L * 2000;
+
+    for (int i = 1; i < 2000; i += 2)
+        m.erase(i);
+    check *= m.empty() && !m.find(5) && snapshot.contains(1999);
+    return check;
+}
+
+bool persistent_map_test() {
+    cout << "start: persistent_map_test" << endl;
+    return persistent_map_check<persistent_map<int, int>>()
+           && persistent_map_check<persistent_map<int, int, colliding_hash>>();
+}
+
+bool buffer_test() {
+    cout << "start: buffer_test" << endl;
+    bool check = true;
+
+    std::vector<buffer_slice> fields;
+    {
+        const std::string text = "id,name\n7,seven\n";
+        linked_buffer buffer(text.size());
+        std::copy(text.begin(), text.end(), buffer.data());
+
+        buffer_slice all = buffer.slice();
+        std::size_t start = 0;
+        for (std::size_t i = 0; i < all.size(); ++i) {
+            if (all[i] == ',' || all[i] == '\n') {
+                fields.push_back(all.slice(start, i - start));
+                start = i + 1;
+            }
+        }
+        check *= all.size() == text.size() && !all.unique();
+    }
+
+    // the buffer is gone, the fields keep the bytes
+    check *= fields.size() == 4 && fields[0] == std::string("id") && fields[3] == std::string("seven");
+    check *= fields[3].slice(1, 3) == std::string("eve") && fields[3].slice(10).empty();
+    fields.resize(1);
+    check *= fields[0].unique() && fields[0].str() == "id";
+
+    // empty slices have no data
+    buffer_slice none;
+    check *= none == buffer_slice() && none == std::string() && none == fields[0].slice(2);
+    check *= none != fields[0] && !(none == std::string("id"));
+    return check;
+}
+
+bool mapped_file_test() {
+    cout << "start: mapped_file_test" << endl;
+    bool check = true;
+
+    char path[] = "/tmp/linked_ptr_mapXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return false;
+    const std::string text = "header\nbody\n";
+    check *= write(fd, text.data(), text.size()) == static_cast<ssize_t>(text.size());
+    close(fd);
+
+    buffer_slice body;
+    {
+        buffer_slice file = map_file(path);
+        check *= file == text && file.unique();
+        body = file.slice(7, 4);
+        check *= !file.unique();
+    }
+    // the mapping lives as long as the view
+    check *= body == std::string("body") && body.unique();
+
+    unlink(path);
+    try {
+        map_file(path);
+        check = false;
+    } catch (const std::system_error& e) {
+        check *= e.code() == std::errc::no_such_file_or_directory;
+    }
+    return check;
+}
+
+bool clone_into_test() {
+    cout << "start: clone_into_test" << endl;
+    bool check = true;
+
+    bool deleted = false;
+    std::vector<linked_ptr<is_deleted>> owners(5);
+    owners[1].reset(new is_deleted(deleted));
+    {
+        linked_ptr<int> p(new int(7));
+        std::vector<linked_ptr<int>> copies(4);
+        copies[2] = p;
+        p.clone_into(copies.begin(), copies.end());
+        for (auto const& c : copies)
+            check *= c == p && *c == 7;
+        copies.resize(1);
+        check *= !p.unique() && !copies[0].unique();
+        copies.clear();
+        check *= p.unique();
+    }
+
+    // the old objects are released
+    linked_ptr<is_deleted> q(new is_deleted(deleted));
+    q.clone_into(owners.begin(), owners.end());
+    check *= deleted && !q.unique();
+    owners.clear();
+    check *= q.unique();
+    q.clone_into(owners.begin(), owners.end());
+    check *= q.unique();
+    return check;
+}
+
+bool destroy_range_test() {
+    cout << "start: destroy_range_test" << endl;
+    bool check = true;
+
+    bool deleted[4] = {false, false, false, false};
+    linked_ptr<is_deleted> outside(new is_deleted(deleted[0]));
+    linked_ptr<is_deleted> shared_inside(new is_deleted(deleted[1]));
+    linked_ptr<is_deleted> mixed(new is_deleted(deleted[3]));
+    linked_ptr<is_deleted> mixed_outside;
+    {
+        linked_ptr_vector<is_deleted> v;
+        v.reserve(8);
+        v.push_back(outside);
+        v.push_back(shared_inside);
+        v.push_back(outside);
+        v.push_back(linked_ptr<is_deleted>(new is_deleted(deleted[2])));
+        v.push_back(shared_inside);
+        v.push_back(mixed);
+        // a ring going in and out of the vector
+        mixed_outside = v[5];
+        v.push_back(mixed_outside);
+        v.push_back(outside);
+        shared_inside.reset();
+        mixed.reset();
+        check *= !deleted[1] && !deleted[2] && !deleted[3];
+    }
+    check *= !deleted[0] && deleted[1] && deleted[2] && !deleted[3];
+    check *= outside.unique() && mixed_outside.unique();
+
+    // a ring inside the array and one owner outside it
+    linked_ptr<int> array[6];
+    linked_ptr<int> keep(new int(1));
+    keep.clone_into(array, array + 3);
+    array[3].reset(new int(2));
+    array[4] = array[3];
+    array[5] = array[3];
+    destroy_range(array, array + 6);
+    for (auto const& p : array)
+        check *= !p && p.unique();
+    check *= keep.unique() && *keep == 1;
+
+    // a run which is the whole ring
+    bool run_deleted = false;
+    linked_ptr<is_deleted> run[3];
+    linked_ptr<is_deleted>(new is_deleted(run_deleted)).clone_into(run, run + 3);
+    destroy_range(run, run + 3);
+    check *= run_deleted && !run[0] && !run[2];
+    return check;
+}
+
+bool batch_test() {
+    cout << "start: batch_test" << endl;
+    bool check = true;
+
+    const std::size_t n = 40;
+    bool deleted = false;
+    std::vector<linked_ptr<int>> src(n);
+    std::vector<linked_ptr<int>> dst(n);
+    for (std::size_t i = 0; i < n; ++i)
+        src[i].reset(new int(int(i % 3 == 0 ? 0 : i)));
+    // the same object already, a null one, and one to be released
+    dst[3] = src[3];
+    src[5].reset();
+    linked_ptr<is_deleted> old(new is_deleted(deleted));
+    std::vector<linked_ptr<is_deleted>> olds(1, old);
+    old.reset();
+
+    copy_n(src.data(), n, dst.data());
+    for (std::size_t i = 0; i < n; ++i)
+        check *= dst[i] == src[i] && (i == 5 ? src[i].unique() : !src[i].unique());
+    linked_ptr<is_deleted> empty;
+    copy_n(&empty, 1, olds.data());
+    check *= deleted && !olds[0];
+
+    reset_n(dst.data(), n);
+    for (std::size_t i = 0; i < n; ++i)
+        check *= !dst[i] && src[i].unique();
+
+    // the source is owned by the object being released
+    linked_ptr<graph_node> none;
+    linked_ptr<graph_node> last(new graph_node(2, none, none));
+    linked_ptr<graph_node> list(new graph_node(1, last, none));
+    last.reset();
+    copy_n(&list->left, 1, &list);
+    check *= list->value == 2 && list.unique();
+    return check;
+}
+
+struct arena_node {
+    static int destroyed;
+
+    ~arena_node() {
+        ++destroyed;
+    }
+
+    linked_ptr<arena_node> edges[2];
+};
+
+int arena_node::destroyed = 0;
+
+bool arena_test() {
+    cout << "start: arena_test" << endl;
+    bool check = true;
+
+    std::vector<linked_ptr<arena_node>> roots(6);
+    {
+        linked_ptr_arena arena;
+        for (auto& root : roots)
+            root.reset(new arena_node());
+        // edges inside the objects, shared, null and a cycle
+        for (std::size_t i = 0; i < roots.size(); ++i) {
+            roots[i]->edges[0] = roots[(i + 1) % roots.size()];
+            if (i % 2 == 0)
+                roots[i]->edges[1] = roots[0];
+            arena.adopt(roots[i]->edges, roots[i]->edges + 2);
+        }
+        linked_ptr<arena_node> single(new arena_node());
+        arena.adopt(single);
+        arena.adopt(roots.data(), roots.data() + roots.size());
+        check *= arena.size() == 19;
+        arena.teardown();
+        check *= arena_node::destroyed == 7 && !single && single.unique() && arena.size() == 0;
+    }
+    for (auto const& root : roots)
+        check *= !root && root.unique();
+    return check;
+}
+
+bool message_bus_test() {
+    cout << "start: message_bus_test" << endl;
+    bool check = true;
+
+    message_bus<std::string> bus(2);
+    auto fast = bus.subscribe();
+    auto slow = bus.subscribe();
+
+    std::string received;
+    auto append = [&](const std::string& s) { received += s; };
+    {
+        linked_ptr<const std::string> message(new std::string("a"));
+        check *= bus.publish(message) == 2 && !message.unique();
+        check *= fast.poll(append) == 1 && received == "a";
+        check *= fast.poll(append) == 0 && slow.pending() == 1;
+    }
+    check *= bus.publish(linked_ptr<const std::string>(new std::string("b"))) == 2;
+    check *= fast.poll(append) == 1;
+    // the slow queue is full, so it misses c
+    linked_ptr<const std::string> last(new std::string("c"));
+    check *= bus.publish(last) == 1 && fast.poll(append) == 1;
+    check *= slow.poll(append, 1) == 1 && slow.pending() == 1;
+    check *= slow.poll(append) == 1 && received == "abcab";
+
+    // consumed slots keep the messages until they are reused or released
+    check *= !last.unique();
+    bus.release();
+    check *= last.unique();
+    check *= bus.publish(last) == 2 && !last.unique();
+
+    // null messages reach no subscriber
+    std::vector<linked_ptr<const std::string>> batch{linked_ptr<const std::string>(), last};
+    check *= bus.publish(batch[0]) == 0 && bus.publish(batch.begin(), batch.end()) == 2;
+    received.clear();
+    check *= fast.poll(append) == 2 && received == "cc";
+    return check;
+}
+
+struct policy_node {
+    static int destroyed;
+
+    ~policy_node() {
+        ++destroyed;
+    }
+
+    linked_ptr<policy_node, linked_ptr_policy<default_deleter, global_lock>> next;
+};
+
+int policy_node::destroyed = 0;
+
+bool policy_test() {
+    cout << "start: policy_test" << endl;
+    bool check = true;
+
+    {
+        using array_ptr = linked_ptr<policy_node, linked_ptr_policy<array_deleter, single_threaded, no_checking>>;
+        array_ptr a(new policy_node[3]);
+        array_ptr b(a);
+        array_ptr c;
+        c = b;
+        a.reset();
+        b.reset();
+        check *= policy_node::destroyed == 0 && c.unique();
+    }
+    check *= policy_node::destroyed == 3;
+
+    {
+        // the lock is taken again while the last owner deletes a chain
+        using locked_ptr = linked_ptr<policy_node, linked_ptr_policy<default_deleter, global_lock>>;
+        locked_ptr head(new policy_node());
+        head->next.reset(new policy_node());
+        head->next->next.reset(new policy_node());
+        locked_ptr second(head->next);
+        check *= !second.unique() && second == head->next;
+        head.reset();
+        check *= policy_node::destroyed == 4 && second.unique();
+    }
+    check *= policy_node::destroyed == 6;
+    return check;
+}
+
+bool handoff_test() {
+    cout << "start: handoff_test" << endl;
+    bool check = true;
+
+    handoff_queue<std::string> queue(2);
+    linked_ptr<std::string> a(new std::string("a"));
+    linked_ptr<std::string> b(new std::string("b"));
+    linked_ptr<std::string> c(new std::string("c"));
+    std::string* sent = a.get();
+    check *= queue.try_push(a) && !a && a.unique();
+    check *= queue.try_push(b) && !queue.try_push(c) && *c == "c";
+
+    linked_ptr<std::string> received(new std::string("old"));
+    check *= queue.try_pop(received) && received.get() == sent && received.unique();
+    check *= queue.try_push(c) && !c;
+    check *= queue.try_pop(received) && *received == "b";
+    check *= queue.try_pop(received) && *received == "c";
+    check *= !queue.try_pop(received) && *received == "c" && queue.empty();
+    return check;
+}
+
+struct sharded_node {
+    static std::atomic<int> destroyed;
+
+    ~sharded_node() {
+        ++destroyed;
+    }
+};
+
+std::atomic<int> sharded_node::destroyed(0);
+
+bool sharded_test() {
+    cout << "start: sharded_test" << endl;
+    bool check = true;
+
+    sharded_ptr<sharded_node> a(new sharded_node());
+    sharded_ptr<sharded_node> b(a);
+    check *= a.shards() == 1 && !a.unique_on_thread() && a.get() == b.get();
+    b.reset();
+    check *= a.unique_on_thread();
+
+    bool ok = false;
+    std::thread([&] {
+        sharded_ptr<sharded_node> local(a);
+        sharded_ptr<sharded_node> copy(local);
+        sharded_ptr<sharded_node> again(a);
+        ok = local.get() == a.get() && local.shards() == 2 && !local.unique_on_thread();
+        copy = sharded_ptr<sharded_node>();
+    }).join();
+    check *= ok && a.shards() == 1 && sharded_node::destroyed == 0;
+
+    // the last thread to leave deletes the object
+    std::atomic<int> step(0);
+    std::thread last([&] {
+        sharded_ptr<sharded_node> local(a);
+        step = 1;
+        while (step != 2)
+            std::this_thread::yield();
+        ok = local.shards() == 1 && sharded_node::destroyed == 0;
+    });
+    while (step != 1)
+        std::this_thread::yield();
+    a.reset();
+    step = 2;
+    last.join();
+    check *= ok && sharded_node::destroyed == 1;
+
+    // assigning a ring neighbour, or the owner itself, keeps the object
+    sharded_ptr<sharded_node> c(new sharded_node());
+    sharded_ptr<sharded_node> d(c);
+    d = c;
+    c = c;
+    check *= c.get() == d.get() && !c.unique_on_thread() && sharded_node::destroyed == 1;
+    c.reset();
+    check *= d.unique_on_thread() && sharded_node::destroyed == 1;
+    d.reset();
+    check *= sharded_node::destroyed == 2;
+    return check;
+}
+
+struct left_base {
+    virtual ~left_base() = default;
+    int l = 0;
+};
+
+struct right_base {
+    virtual ~right_base() = default;
+    int r = 0;
+};
+
+struct both_bases : left_base, right_base {};
+
+bool lookup_test() {
+    cout << "start: lookup_test" << endl;
+    bool check = true;
+
+    linked_ptr<int> p1(new int(1));
+    linked_ptr<int> p2(new int(2));
+    linked_ptr<int> empty;
+    check *= p1 == p1.get() && p2.get() != p1 && empty == nullptr && nullptr != p1;
+
+    // raw pointers and nullptr are ordered like the owners
+    int* raw1 = p1.get();
+    bool less = p1 < p2;
+    check *= (p1 < p2.get()) == less && (raw1 < p2) == less && (p2.get() > p1) == less && (p2 > raw1) == less;
+    check *= p1 <= raw1 && raw1 <= p1 && p1 >= raw1 && raw1 >= p1 && !(p1 < raw1) && !(raw1 > p1);
+    check *= !(empty < nullptr) && !(nullptr < empty) && empty <= nullptr && nullptr >= empty;
+    check *= (nullptr < p1) == !(p1 <= nullptr) && (p1 > nullptr) == (nullptr < p1);
+
+    std::set<linked_ptr<int>, ptr_less> ordered{p1, p2};
+    check *= ordered.find(p2.get()) != ordered.end() && ordered.count(empty.get()) == 0;
+    check *= ordered.count(nullptr) == 0 && ptr_less()(nullptr, p1) && !ptr_less()(empty, nullptr);
+    check *= p2.unique() == false;
+
+    std::unordered_set<linked_ptr<int>> hashed{p1, p2};
+    check *= hashed.count(p1) == 1 && hashed.count(empty) == 0;
+    check *= ptr_hash()(p1) == ptr_hash()(p1.get()) && ptr_hash()(p1) == std::hash<linked_ptr<int>>()(p1);
+    check *= ptr_equal()(p1.get(), p1) && !ptr_equal()(p1, nullptr);
+    check *= ptr_hash()(nullptr) == ptr_hash()(empty) && ptr_hash()(nullptr) == ptr_hash()(empty.get());
+
+    // both owners hold one object through bases at different addresses
+    linked_ptr<both_bases> object(new both_bases());
+    linked_ptr<right_base> right(object);
+    const void* left_address = static_cast<left_base*>(object.get());
+    check *= left_address != static_cast<const void*>(right.get());
+    check *= !owner_less()(object, right) && !owner_less()(right, object);
+    check *= !ptr_less()(object, right) && !ptr_less()(right, object.get());
+    return check;
+}
+
+bool flat_set_test() {
+    cout << "start: flat_set_test" << endl;
+    bool check = true;
+
+    std::vector<linked_ptr<int>> owners;
+    for (int i = 0; i < 40; ++i)
+        owners.emplace_back(new int(i));
+
+    linked_ptr_flat_set<int> set(owners.begin(), owners.begin() + 10);
+    check *= set.size() == 10 && !owners[0].unique();
+    check *= set.insert(owners[20]) && !set.insert(owners[20]) && !set.insert(linked_ptr<int>());
+    // a batch with duplicates and objects already in the set
+    check *= set.insert(owners.begin() + 5, owners.end()) == 29 && set.size() == 40;
+    check *= set.insert(owners.begin(), owners.end()) == 0;
+    check *= std::is_sorted(set.begin(), set.end(), ptr_less());
+    for (auto const& p : owners)
+        check *= set.contains(p.get()) && *set.find(p) == p;
+
+    linked_ptr<int> other(new int(-1));
+    check *= set.find(other.get()) == set.end() && set.count(nullptr) == 0;
+    check *= set.erase(owners[7].get()) && !set.erase(owners[7]) && owners[7].unique();
+
+    linked_ptr_flat_set<int> more;
+    more.insert(other);
+    more.insert(owners[7]);
+    check *= set.merge(more) == 2 && set.size() == 41 && set.contains(other);
+
+    more.clear();
+    check *= !other.unique();
+    set.clear();
+    for (auto const& p : owners)
+        check *= p.unique();
+    check *= other.unique();
+    return check;
+}
+
+bool scan_test() {
+    cout << "start: scan_test" << endl;
+    bool check = true;
+
+    // odd sizes leave a tail after the vector lanes
+    std::vector<linked_ptr<int>> owners(13);
+    for (std::size_t i = 0; i < owners.size(); i += 3)
+        owners[i].reset(new int(static_cast<int>(i)));
+    linked_ptr<int> shared(owners[9]);
+    linked_ptr<int>* first = owners.data();
+    linked_ptr<int>* last = first + owners.size();
+
+    check *= find_pointee(first, last, owners[9].get()) == first + 9;
+    check *= find_pointee(first, last, owners[12].get()) == first + 12;
+    check *= find_pointee(first, last, shared.get() + 1) == last;
+    check *= find_pointee(first, last, static_cast<int*>(nullptr)) == first + 1;
+    check *= find_pointee(first, last, nullptr) == first + 1;
+    const linked_ptr<int>* begin = first;
+    check *= find_pointee(begin, begin + owners.size(), nullptr) == begin + 1;
+    check *= count_non_null(first, last) == 5 && count_non_null(first, first + 3) == 1;
+
+    linked_ptr<int>* nulls = partition_null(first, last);
+    check *= nulls == first + 5 && count_non_null(nulls, last) == 0;
+    for (int i = 0; i < 5; ++i)
+        check *= *first[i] == 3 * i;
+    check *= first[3] == shared && !shared.unique();
+    owners.clear();
+    check *= shared.unique();
+    return check;
+}
+
 int main() {
     if (!base_test()) {
         std::cerr << "base_test failed" << std::endl;
@@ -232,6 +1332,112 @@ int main() {
         std::cerr << "test_swap failed" << std::endl;
     } else cout << "ok" << endl;
 
+    if (!offset_test()) {
+        std::cerr << "offset_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!snapshot_test()) {
+        std::cerr << "snapshot_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!assign_test()) {
+        std::cerr << "assign_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!serializer_test()) {
+        std::cerr << "serializer_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!cache_test()) {
+        std::cerr << "cache_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!interner_test()) {
+        std::cerr << "interner_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!cow_test()) {
+        std::cerr << "cow_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!persistent_vector_test()) {
+        std::cerr << "persistent_vector_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!persistent_map_test()) {
+        std::cerr << "persistent_map_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!buffer_test()) {
+        std::cerr << "buffer_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!mapped_file_test()) {
+        std::cerr << "mapped_file_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!clone_into_test()) {
+        std::cerr << "clone_into_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!destroy_range_test()) {
+        std::cerr << "destroy_range_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!batch_test()) {
+        std::cerr << "batch_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!arena_test()) {
+        std::cerr << "arena_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!message_bus_test()) {
+        std::cerr << "message_bus_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!policy_test()) {
+        std::cerr << "policy_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!handoff_test()) {
+        std::cerr << "handoff_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!sharded_test()) {
+        std::cerr << "sharded_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!lookup_test()) {
+        std::cerr << "lookup_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!flat_set_test()) {
+        std::cerr << "flat_set_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+    if (!scan_test()) {
+        std::cerr << "scan_test failed" << std::endl;
+    } else cout << "ok" << endl;
+
+#ifdef LINKED_PTR_DEBUG
+    if (!debug_test()) {
+        std::cerr << "debug_test failed" << std::endl;
+    } else cout << "ok" << endl;
+#endif
+
+#ifdef LINKED_PTR_THREAD_CHECK
+    if (!thread_check_test()) {
+        std::cerr << "thread_check_test failed" << std::endl;
+    } else cout << "ok" << endl;
+#endif
+
+#ifdef LINKED_PTR_STATS
+    if (!stats_test()) {
+        std::cerr << "stats_test failed" << std::endl;
+    } else cout << "ok" << endl;
+#endif
+
     return 0;
 }
 
@@ -0,0 +1,71 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cerrno>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "linked_buffer.h"
+
+namespace smart_ptr {
+
+namespace details {
+
+    // the last slice of the mapping unmaps it
+    class mapped_storage : public buffer_storage {
+    public:
+        mapped_storage(char* data, std::size_t size) noexcept : buffer_storage(data, size) {}
+
+        ~mapped_storage() override {
+            ::munmap(data(), size());
+        }
+    };
+
+} // namespace details
+
+/// Maps the whole file read-only. Slices of the result (and slices of
+/// those) share the mapping, which is unmapped with the last of them.
+/// Throws std::system_error if the file can not be mapped.
+inline buffer_slice map_file(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), "map_file: open " + path);
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), "map_file: stat " + path);
+    }
+
+    std::size_t size = static_cast<std::size_t>(info.st_size);
+    if (size == 0) {
+        ::close(fd);
+        return buffer_slice();
+    }
+
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int error = errno;
+    ::close(fd);
+    if (data == MAP_FAILED)
+        throw std::system_error(error, std::generic_category(), "map_file: mmap " + path);
+
+    details::buffer_storage* mapped;
+    try {
+        mapped = new details::mapped_storage(static_cast<char*>(data), size);
+    } catch (...) {
+        ::munmap(data, size);
+        throw;
+    }
+    linked_ptr<details::buffer_storage> storage(mapped);
+    return buffer_slice(storage, storage->data(), size);
+}
+
+} // namespace smart_ptr
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,186 @@
+#ifndef MESSAGE_BUS_H
+#define MESSAGE_BUS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <limits>
+#include <vector>
+
+#include "linked_ptr.h"
+
+namespace smart_ptr {
+
+/// Single-process publish/subscribe without copying the messages:
+/// every subscriber gets the published linked_ptr in its own lock-free
+/// single-producer single-consumer queue. The new owners are linked
+/// among themselves first and joined to the ring of the message in one
+/// splice, so a publish writes the ring of the message once whatever
+/// the number of subscribers. Publishing a batch of messages makes
+/// them visible with one store per queue.
+///
+/// linked_ptr is not thread-safe, so every ring change happens on the
+/// publisher thread: a subscriber only reads the message and moves its
+/// tail, the publisher releases the consumed slots on its next publish.
+/// Subscribe before publishing starts (or on the publisher thread);
+/// each subscriber is polled by one thread at a time.
+template <typename T>
+class message_bus {
+    // shared by the publisher and one subscriber
+    struct queue {
+        explicit queue(std::size_t capacity) : slots(capacity) {}
+
+        std::vector<linked_ptr<const T>> slots;
+        std::atomic<std::size_t> head{0};
+        // head and tail are written by different threads
+        char padding[64];
+        std::atomic<std::size_t> tail{0};
+    };
+
+    // the publisher side of a queue, kept in an array of its own
+    // so that a publish walks a few cache lines per subscriber
+    struct producer {
+        queue* q;
+        linked_ptr<const T>* slots;
+        // copy of head, and the slots below are released
+        std::size_t published;
+        std::size_t released;
+    };
+
+public:
+    class subscriber {
+    public:
+        /// Calls f(const T&) for up to max pending messages, returns their number
+        template <typename F>
+        std::size_t poll(F&& f, std::size_t max = std::numeric_limits<std::size_t>::max()) {
+            std::size_t tail = _queue->tail.load(std::memory_order_relaxed);
+            std::size_t head = _queue->head.load(std::memory_order_acquire);
+            std::size_t mask = _queue->slots.size() - 1;
+            std::size_t n = 0;
+            for (; tail != head && n < max; ++n) {
+                f(*_queue->slots[tail & mask]);
+                _queue->tail.store(++tail, std::memory_order_release);
+            }
+            return n;
+        }
+
+        std::size_t pending() const noexcept {
+            return _queue->head.load(std::memory_order_acquire) - _queue->tail.load(std::memory_order_relaxed);
+        }
+
+    private:
+        friend class message_bus;
+
+        explicit subscriber(queue* q) noexcept : _queue(q) {}
+
+        queue* _queue;
+    };
+
+    /// capacity: messages a subscriber may fall behind, rounded up to a power of two
+    explicit message_bus(std::size_t capacity = 1024) : _capacity(1) {
+        while (_capacity < capacity)
+            _capacity *= 2;
+    }
+
+    message_bus(const message_bus&) = delete;
+    message_bus& operator=(const message_bus&) = delete;
+
+    /// The handle is valid as long as the bus
+    subscriber subscribe() {
+        _queues.emplace_back(_capacity);
+        queue& q = _queues.back();
+        _producers.push_back(producer{&q, q.slots.data(), 0, 0});
+        return subscriber(&q);
+    }
+
+    /// Returns the number of subscribers that got the message,
+    /// the ones whose queue is full miss it
+    std::size_t publish(const linked_ptr<const T>& message) {
+        return publish(&message, &message + 1);
+    }
+
+    /// Publishes the messages in order, the subscribers see all of them
+    /// at once; null messages are skipped. Returns the number of deliveries.
+    template <typename It>
+    std::size_t publish(It first, It last) {
+        // the consumed slots are released once per batch, then every
+        // queue has room for at least the next `room` messages
+        std::size_t room = _capacity;
+        for (producer& p : _producers) {
+            release(p);
+            room = std::min(room, _capacity - (p.published - p.released));
+        }
+
+        std::size_t mask = _capacity - 1;
+        std::size_t deliveries = 0;
+        for (; first != last; ++first) {
+            const linked_ptr<const T>& message = *first;
+            if (!message)
+                continue;
+            producer* p = _producers.data();
+            if (room > 0) {
+                --room;
+                details::linked_ptr_access::share(message, _producers.size(), [&]() -> linked_ptr<const T>& {
+                    producer& target = *p++;
+                    return target.slots[target.published++ & mask];
+                });
+                deliveries += _producers.size();
+                continue;
+            }
+
+            // some queue is full: skip it, unless its subscriber caught up
+            std::size_t n = 0;
+            for (producer& q : _producers) {
+                if (!has_room(q))
+                    release(q);
+                n += has_room(q);
+            }
+            details::linked_ptr_access::share(message, n, [&]() -> linked_ptr<const T>& {
+                while (!has_room(*p))
+                    ++p;
+                producer& target = *p++;
+                return target.slots[target.published++ & mask];
+            });
+            deliveries += n;
+        }
+
+        // a cache line of every queue is written once per batch
+        for (producer& p : _producers)
+            p.q->head.store(p.published, std::memory_order_release);
+        return deliveries;
+    }
+
+    /// Drops the ownership of the messages consumed so far
+    /// without waiting for the next publish
+    void release() noexcept {
+        for (producer& p : _producers)
+            release(p);
+    }
+
+    std::size_t subscribers() const noexcept {
+        return _producers.size();
+    }
+
+private:
+    bool has_room(const producer& p) const noexcept {
+        return p.published - p.released < _capacity;
+    }
+
+    // drops the ownership of the messages consumed since the last call
+    void release(producer& p) noexcept {
+        std::size_t tail = p.q->tail.load(std::memory_order_acquire);
+        std::size_t mask = _capacity - 1;
+        for (; p.released != tail; ++p.released)
+            p.slots[p.released & mask].reset();
+    }
+
+    std::size_t _capacity;
+    // a deque keeps the queues in place for the subscribers
+    std::deque<queue> _queues;
+    std::vector<producer> _producers;
+};
+
+} // namespace smart_ptr
+
+#endif // MESSAGE_BUS_H
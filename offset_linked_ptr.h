@@ -0,0 +1,382 @@
+#ifndef OFFSET_LINKED_PTR_H
+#define OFFSET_LINKED_PTR_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace smart_ptr {
+
+template <typename T>
+class offset_linked_ptr;
+
+namespace details {
+
+    // byte distance from one address to another
+    inline std::ptrdiff_t offset_between(const void* from, const void* to) noexcept {
+        return reinterpret_cast<const char*>(to) - reinterpret_cast<const char*>(from);
+    }
+
+    // Same ring as linked_ptr_base, but the links are stored as offsets
+    // relative to the node itself, so the ring stays valid wherever the
+    // memory holding it is mapped. Offset 0 means "points to itself".
+    struct offset_linked_ptr_base {
+        offset_linked_ptr_base() noexcept = default;
+
+        offset_linked_ptr_base(const offset_linked_ptr_base&) = delete;
+        offset_linked_ptr_base& operator=(const offset_linked_ptr_base&) = delete;
+
+        offset_linked_ptr_base* left() const noexcept {
+            return resolve(_left);
+        }
+
+        offset_linked_ptr_base* right() const noexcept {
+            return resolve(_right);
+        }
+
+        // this element is the only one in the list
+        bool unique() const noexcept {
+            return _left == 0 && _right == 0;
+        }
+
+        void swap(offset_linked_ptr_base& other) noexcept {
+            // nothing to swap if the elements are unique
+            if (unique() && other.unique())
+                return;
+
+            offset_linked_ptr_base* l = left();
+            offset_linked_ptr_base* r = right();
+            bool was_unique = unique();
+
+            if (other.unique())
+                unlink();
+            else
+                link_between(*other.left(), *other.right());
+
+            if (was_unique)
+                other.unlink();
+            else
+                other.link_between(*l, *r);
+        }
+
+        // insert this element after rhs
+        // is used only in offset_linked_ptr constructors and assignment
+        void insert_after(offset_linked_ptr_base& rhs) noexcept {
+            assert(unique());
+            link_between(rhs, *rhs.right());
+        }
+
+        void erase() noexcept {
+            offset_linked_ptr_base* l = left();
+            offset_linked_ptr_base* r = right();
+            r->set_left(l);
+            l->set_right(r);
+            unlink();
+        }
+
+    private:
+        offset_linked_ptr_base* resolve(std::ptrdiff_t offset) const noexcept {
+            return reinterpret_cast<offset_linked_ptr_base*>(
+                    const_cast<char*>(reinterpret_cast<const char*>(this)) + offset);
+        }
+
+        void set_left(offset_linked_ptr_base* p) noexcept {
+            _left = offset_between(this, p);
+        }
+
+        void set_right(offset_linked_ptr_base* p) noexcept {
+            _right = offset_between(this, p);
+        }
+
+        void unlink() noexcept {
+            _left = _right = 0;
+        }
+
+        // l and r are neighbours in a ring (possibly the same node)
+        void link_between(offset_linked_ptr_base& l, offset_linked_ptr_base& r) noexcept {
+            set_left(&l);
+            set_right(&r);
+            r.set_left(this);
+            l.set_right(this);
+        }
+
+        std::ptrdiff_t _left = 0;
+        std::ptrdiff_t _right = 0;
+    };
+
+} // namespace details
+
+/// linked_ptr whose pointee and ring links are self-relative offsets.
+/// The pointee and every owner have to live in the same mapping
+/// (see segment below); the last owner runs the destructor of the
+/// pointee in place, the memory itself belongs to the mapping.
+template <typename T>
+class offset_linked_ptr {
+    template <typename Y>
+    friend class offset_linked_ptr;
+
+public:
+    using element_type = T;
+
+private:
+    template <typename Y>
+    using type_compatible = std::enable_if_t<std::is_convertible<Y*, T*>::value>;
+    // offset of the pointee from &_ptr, 0 is nullptr
+    std::ptrdiff_t _ptr = 0;
+    mutable details::offset_linked_ptr_base base;
+
+    void set(T* ptr) noexcept {
+        _ptr = ptr ? details::offset_between(&_ptr, ptr) : 0;
+    }
+
+public:
+    // Constructors
+    offset_linked_ptr() noexcept = default;
+
+    explicit offset_linked_ptr(std::nullptr_t) noexcept : offset_linked_ptr() {}
+
+    offset_linked_ptr(const offset_linked_ptr& rhs) noexcept {
+        base.insert_after(rhs.base);
+        set(rhs.get());
+    }
+
+    template <typename Y, typename = type_compatible<Y> >
+    explicit offset_linked_ptr(Y* ptr) noexcept {
+        set(static_cast<T*>(ptr));
+    }
+
+    template <typename Y, typename = type_compatible<Y> >
+    offset_linked_ptr(const offset_linked_ptr<Y>& rhs) noexcept {
+        base.insert_after(rhs.base);
+        set(static_cast<T*>(rhs.get()));
+    }
+
+    ~offset_linked_ptr() {
+        reset();
+    }
+
+    // Info
+
+    T* get() const noexcept {
+        if (_ptr == 0)
+            return nullptr;
+        return reinterpret_cast<T*>(const_cast<char*>(reinterpret_cast<const char*>(&_ptr)) + _ptr);
+    }
+
+    bool unique() const noexcept {
+        return base.unique();
+    }
+
+    // Modification
+
+    template <typename Y, typename = type_compatible<Y> >
+    void reset(Y* ptr) {
+        release();
+        set(static_cast<T*>(ptr));
+    }
+
+    void reset() noexcept {
+        release();
+        _ptr = 0;
+    }
+
+    void swap(offset_linked_ptr& other) noexcept {
+        if (get() == other.get())
+            return;
+
+        T* ptr = get();
+        base.swap(other.base);
+        set(other.get());
+        other.set(ptr);
+    }
+
+    // Operators
+
+    offset_linked_ptr& operator=(const offset_linked_ptr& rhs) noexcept {
+        return assign(rhs);
+    }
+
+    template <typename Y, typename = type_compatible<Y> >
+    offset_linked_ptr& operator=(const offset_linked_ptr<Y>& rhs) noexcept {
+        return assign(rhs);
+    }
+
+    /// Access operators
+    T& operator*() const noexcept {
+        return *get();
+    }
+
+    T* operator->() const noexcept {
+        return get();
+    }
+
+    /// Logical expression
+    explicit operator bool() const noexcept {
+        return _ptr != 0;
+    }
+
+private:
+    void release() noexcept {
+        if (unique()) {
+            if (T* ptr = get())
+                ptr->~T();
+        } else {
+            base.erase();
+        }
+    }
+
+    // rhs may live inside the old pointee (head = head->next), so join
+    // its ring first and destroy the old pointee last
+    template <typename Y>
+    offset_linked_ptr& assign(const offset_linked_ptr<Y>& rhs) noexcept {
+        T* ptr = static_cast<T*>(rhs.get());
+        T* old = get();
+        if (old == ptr)
+            return *this;
+        const bool last = unique();
+        if (!last)
+            base.erase();
+        base.insert_after(rhs.base);
+        set(ptr);
+        if (last && old != nullptr)
+            old->~T();
+        return *this;
+    }
+}; // offset_linked_ptr
+
+/// Logic operators
+template <typename T, typename Y>
+bool operator==(const offset_linked_ptr<T>& lhs, const offset_linked_ptr<Y>& rhs) noexcept {
+    return lhs.get() == rhs.get();
+}
+
+template <typename T, typename Y>
+bool operator!=(const offset_linked_ptr<T>& lhs, const offset_linked_ptr<Y>& rhs) noexcept {
+    return !(lhs == rhs);
+}
+
+/// Bump allocator over a memory region (shared memory, mmap'd file).
+/// Its bookkeeping lives at the start of the region, so every process
+/// mapping the region sees the same state. Memory is never given back:
+/// destroying an object in the segment only runs its destructor.
+class segment {
+    struct header {
+        std::uint64_t magic;
+        std::size_t capacity;
+        std::atomic<std::size_t> used;
+        // offset of the root object from the start of the region, 0 if none
+        std::atomic<std::size_t> root;
+    };
+
+    static constexpr std::uint64_t segment_magic = 0x6c696e6b65647365; // "linkedse"
+
+public:
+    /// Invalid segment
+    segment() noexcept = default;
+
+    /// Formats region of given size as an empty segment
+    static segment create(void* region, std::size_t size) noexcept {
+        assert(size >= sizeof(header));
+        header* h = new (region) header;
+        h->magic = segment_magic;
+        h->capacity = size;
+        h->used.store(sizeof(header), std::memory_order_relaxed);
+        h->root.store(0, std::memory_order_release);
+        return segment(h, size);
+    }
+
+    /// Opens segment previously formatted by create (possibly mapped at
+    /// another address), returns an invalid segment if region is not one.
+    /// If size is given, this segment object is limited to the first size
+    /// bytes (a snapshot only stores the used part of the region); the
+    /// header shared with the other mappings is left alone.
+    static segment attach(void* region, std::size_t size = 0) noexcept {
+        header* h = static_cast<header*>(region);
+        if (size != 0 && size < sizeof(header))
+            return segment(nullptr, 0);
+        if (h->magic != segment_magic)
+            return segment(nullptr, 0);
+        if (size == 0 || size > h->capacity)
+            size = h->capacity;
+        if (h->used.load(std::memory_order_acquire) > size)
+            return segment(nullptr, 0);
+        return segment(h, size);
+    }
+
+    explicit operator bool() const noexcept {
+        return _header != nullptr;
+    }
+
+    void* data() const noexcept {
+        return _header;
+    }
+
+    std::size_t capacity() const noexcept {
+        return _capacity;
+    }
+
+    std::size_t used() const noexcept {
+        return _header->used.load(std::memory_order_acquire);
+    }
+
+    /// nullptr if the segment is exhausted
+    void* allocate(std::size_t size, std::size_t align = alignof(std::max_align_t)) noexcept {
+        std::size_t used = _header->used.load(std::memory_order_relaxed);
+        std::size_t begin;
+        do {
+            begin = (used + align - 1) / align * align;
+            if (begin + size > _capacity)
+                return nullptr;
+        } while (!_header->used.compare_exchange_weak(used, begin + size, std::memory_order_acq_rel));
+        return base() + begin;
+    }
+
+    template <typename T, typename... Args>
+    T* construct(Args&&... args) {
+        void* memory = allocate(sizeof(T), alignof(T));
+        if (memory == nullptr)
+            throw std::bad_alloc();
+        return new (memory) T(std::forward<Args>(args)...);
+    }
+
+    bool contains(const void* ptr) const noexcept {
+        const char* p = static_cast<const char*>(ptr);
+        return p >= base() && p < base() + _capacity;
+    }
+
+    /// Root object for other processes to start from
+    template <typename T>
+    void set_root(T* root) noexcept {
+        assert(root == nullptr || contains(root));
+        _header->root.store(root ? static_cast<std::size_t>(reinterpret_cast<char*>(root) - base()) : 0,
+                            std::memory_order_release);
+    }
+
+    /// nullptr if none, or the segment is invalid
+    template <typename T>
+    T* root() const noexcept {
+        if (_header == nullptr)
+            return nullptr;
+        std::size_t offset = _header->root.load(std::memory_order_acquire);
+        return offset ? reinterpret_cast<T*>(base() + offset) : nullptr;
+    }
+
+private:
+    segment(header* h, std::size_t capacity) noexcept : _header(h), _capacity(capacity) {}
+
+    char* base() const noexcept {
+        return reinterpret_cast<char*>(_header);
+    }
+
+    header* _header = nullptr;
+    // of this attachment, at most the one in the header
+    std::size_t _capacity = 0;
+};
+
+} // namespace smart_ptr
+
+#endif // OFFSET_LINKED_PTR_H
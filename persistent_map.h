@@ -0,0 +1,231 @@
+#ifndef PERSISTENT_MAP_H
+#define PERSISTENT_MAP_H
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "linked_ptr.h"
+
+namespace smart_ptr {
+
+namespace details {
+
+    inline unsigned popcount(std::uint32_t bits) noexcept {
+#if defined(__GNUC__)
+        // a single popcnt where the target has it
+        return __builtin_popcount(bits);
+#else
+        return static_cast<unsigned>(std::bitset<32>(bits).count());
+#endif
+    }
+
+} // namespace details
+
+/// Hash map with O(1) snapshots: a hash array mapped trie whose nodes
+/// are shared through linked_ptr. Every node keeps two 32-bit bitmaps
+/// (slots holding entries, slots holding children) and compact arrays
+/// indexed by the popcount of the bits below the slot. Copying the map
+/// is a snapshot; a change copies the shared nodes on the path and
+/// changes in place the ones only this map owns (linked_ptr::unique()).
+template <typename K, typename V, typename Hash = std::hash<K>, typename Equal = std::equal_to<K> >
+class persistent_map {
+    static const unsigned bits = 5;
+    static const unsigned hash_bits = 8 * sizeof(std::size_t);
+
+    struct node {
+        std::uint32_t datamap = 0;
+        std::uint32_t nodemap = 0;
+        // below hash_bits in slot order; past them (full collision) unordered
+        std::vector<std::pair<K, V>> entries;
+        std::vector<linked_ptr<node>> children;
+    };
+
+public:
+    using key_type = K;
+    using mapped_type = V;
+
+    explicit persistent_map(const Hash& hash = Hash(), const Equal& equal = Equal())
+            : _hash(hash), _equal(equal) {}
+
+    // Info
+
+    std::size_t size() const noexcept {
+        return _size;
+    }
+
+    bool empty() const noexcept {
+        return _size == 0;
+    }
+
+    /// Value for the key or nullptr
+    const V* find(const K& key) const {
+        std::size_t hash = _hash(key);
+        const node* n = _root.get();
+        for (unsigned shift = 0; n != nullptr; shift += bits) {
+            if (shift >= hash_bits) {
+                for (auto const& e : n->entries)
+                    if (_equal(e.first, key))
+                        return &e.second;
+                return nullptr;
+            }
+            std::uint32_t bit = slot_bit(hash, shift);
+            if (n->datamap & bit) {
+                auto const& e = n->entries[index(n->datamap, bit)];
+                return _equal(e.first, key) ? &e.second : nullptr;
+            }
+            if (!(n->nodemap & bit))
+                return nullptr;
+            n = n->children[index(n->nodemap, bit)].get();
+        }
+        return nullptr;
+    }
+
+    bool contains(const K& key) const {
+        return find(key) != nullptr;
+    }
+
+    /// Calls f(key, value) for every entry
+    template <typename F>
+    void for_each(F&& f) const {
+        if (_root)
+            visit(*_root, f);
+    }
+
+    // Modification
+
+    /// Returns whether the key is new
+    bool insert_or_assign(const K& key, const V& value) {
+        bool inserted = insert(_root, _hash(key), 0, key, value);
+        _size += inserted;
+        return inserted;
+    }
+
+    bool erase(const K& key) {
+        if (!_root || !find(key))
+            return false;
+        remove(_root, _hash(key), 0, key);
+        --_size;
+        if (_size == 0)
+            _root.reset();
+        return true;
+    }
+
+    void clear() noexcept {
+        _root.reset();
+        _size = 0;
+    }
+
+private:
+    static std::uint32_t slot_bit(std::size_t hash, unsigned shift) noexcept {
+        return std::uint32_t(1) << ((hash >> shift) & ((1u << bits) - 1));
+    }
+
+    static std::size_t index(std::uint32_t map, std::uint32_t bit) noexcept {
+        return details::popcount(map & (bit - 1));
+    }
+
+    // node which may be changed by this map only
+    static node& editable(linked_ptr<node>& ptr) {
+        if (!ptr)
+            ptr.reset(new node());
+        else if (!ptr.unique())
+            ptr.reset(new node(*ptr));
+        return *ptr;
+    }
+
+    bool insert(linked_ptr<node>& ptr, std::size_t hash, unsigned shift, const K& key, const V& value) {
+        node& n = editable(ptr);
+        if (shift >= hash_bits) {
+            for (auto& e : n.entries) {
+                if (_equal(e.first, key)) {
+                    e.second = value;
+                    return false;
+                }
+            }
+            n.entries.emplace_back(key, value);
+            return true;
+        }
+
+        std::uint32_t bit = slot_bit(hash, shift);
+        if (n.nodemap & bit)
+            return insert(n.children[index(n.nodemap, bit)], hash, shift + bits, key, value);
+
+        if (!(n.datamap & bit)) {
+            n.entries.emplace(n.entries.begin() + index(n.datamap, bit), key, value);
+            n.datamap |= bit;
+            return true;
+        }
+
+        std::size_t i = index(n.datamap, bit);
+        if (_equal(n.entries[i].first, key)) {
+            n.entries[i].second = value;
+            return false;
+        }
+
+        // two keys in one slot: push both a level down
+        linked_ptr<node> child;
+        insert(child, _hash(n.entries[i].first), shift + bits, n.entries[i].first, n.entries[i].second);
+        insert(child, hash, shift + bits, key, value);
+        n.entries.erase(n.entries.begin() + i);
+        n.datamap &= ~bit;
+        n.children.insert(n.children.begin() + index(n.nodemap, bit), child);
+        n.nodemap |= bit;
+        return true;
+    }
+
+    // the key is in the map
+    void remove(linked_ptr<node>& ptr, std::size_t hash, unsigned shift, const K& key) {
+        node& n = editable(ptr);
+        if (shift >= hash_bits) {
+            for (std::size_t i = 0; i < n.entries.size(); ++i) {
+                if (_equal(n.entries[i].first, key)) {
+                    n.entries.erase(n.entries.begin() + i);
+                    return;
+                }
+            }
+            return;
+        }
+
+        std::uint32_t bit = slot_bit(hash, shift);
+        if (n.datamap & bit) {
+            n.entries.erase(n.entries.begin() + index(n.datamap, bit));
+            n.datamap &= ~bit;
+            return;
+        }
+
+        std::size_t i = index(n.nodemap, bit);
+        remove(n.children[i], hash, shift + bits, key);
+        node& child = *n.children[i];
+        if (!child.children.empty() || child.entries.size() > 1)
+            return;
+
+        // a child left with one entry (or none) folds back into this node
+        n.nodemap &= ~bit;
+        if (!child.entries.empty()) {
+            n.entries.insert(n.entries.begin() + index(n.datamap, bit), child.entries.front());
+            n.datamap |= bit;
+        }
+        n.children.erase(n.children.begin() + i);
+    }
+
+    template <typename F>
+    static void visit(const node& n, F& f) {
+        for (auto const& e : n.entries)
+            f(e.first, e.second);
+        for (auto const& child : n.children)
+            visit(*child, f);
+    }
+
+    linked_ptr<node> _root;
+    std::size_t _size = 0;
+    Hash _hash;
+    Equal _equal;
+};
+
+} // namespace smart_ptr
+
+#endif // PERSISTENT_MAP_H
@@ -0,0 +1,159 @@
+#ifndef PERSISTENT_VECTOR_H
+#define PERSISTENT_VECTOR_H
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "linked_ptr.h"
+
+namespace smart_ptr {
+
+/// Vector with O(1) snapshots: a 32-ary radix trie whose nodes are
+/// shared through linked_ptr. Copying the vector is a snapshot; a change
+/// copies the nodes on the path that are shared with another snapshot
+/// and changes in place the ones it owns alone (linked_ptr::unique()),
+/// so a vector without snapshots is updated without copying at all.
+template <typename T>
+class persistent_vector {
+    static const unsigned bits = 5;
+    static const std::size_t width = std::size_t(1) << bits;
+    static const std::size_t mask = width - 1;
+
+    struct node {
+        // one of them is used: children in inner nodes, values in leaves
+        std::vector<linked_ptr<node>> children;
+        std::vector<T> values;
+    };
+
+public:
+    using value_type = T;
+
+    persistent_vector() noexcept = default;
+
+    // Info
+
+    std::size_t size() const noexcept {
+        return _size;
+    }
+
+    bool empty() const noexcept {
+        return _size == 0;
+    }
+
+    const T& operator[](std::size_t i) const noexcept {
+        const node* n = _root.get();
+        for (unsigned level = _shift; level > 0; level -= bits)
+            n = n->children[(i >> level) & mask].get();
+        return n->values[i & mask];
+    }
+
+    const T& at(std::size_t i) const {
+        if (i >= _size)
+            throw std::out_of_range("persistent_vector::at");
+        return (*this)[i];
+    }
+
+    const T& back() const noexcept {
+        return (*this)[_size - 1];
+    }
+
+    // Modification
+
+    void push_back(const T& value) {
+        if (!_root) {
+            editable(_root, 0);
+        } else if (_size == std::size_t(1) << (_shift + bits)) {
+            // the trie is full, grow a level on top
+            linked_ptr<node> root(new node());
+            root->children.reserve(width);
+            root->children.push_back(_root);
+            _root = root;
+            _shift += bits;
+        }
+
+        node* n = &editable(_root, _shift);
+        for (unsigned level = _shift; level > 0; level -= bits) {
+            std::size_t index = (_size >> level) & mask;
+            if (index == n->children.size())
+                n->children.emplace_back();
+            n = &editable(n->children[index], level - bits);
+        }
+        n->values.push_back(value);
+        ++_size;
+    }
+
+    void set(std::size_t i, const T& value) {
+        node* n = &editable(_root, _shift);
+        for (unsigned level = _shift; level > 0; level -= bits)
+            n = &editable(n->children[(i >> level) & mask], level - bits);
+        n->values[i & mask] = value;
+    }
+
+    void pop_back() {
+        --_size;
+        pop(_root, _shift);
+        if (_size == 0) {
+            _root.reset();
+            _shift = 0;
+        } else if (_shift > 0 && _root->children.size() == 1) {
+            // drop a level with a single child
+            linked_ptr<node> child = _root->children.front();
+            _root = child;
+            _shift -= bits;
+        }
+    }
+
+    void clear() noexcept {
+        _root.reset();
+        _size = 0;
+        _shift = 0;
+    }
+
+private:
+    // node at level which may be changed by this vector only; room for
+    // width children or values, whichever the level uses
+    static node& editable(linked_ptr<node>& ptr, unsigned level) {
+        if (!ptr) {
+            ptr.reset(new node());
+            if (level > 0)
+                ptr->children.reserve(width);
+            else
+                ptr->values.reserve(width);
+        } else if (!ptr.unique()) {
+            node* copy = new node();
+            if (level > 0) {
+                copy->children.reserve(width);
+                copy->children = ptr->children;
+            } else {
+                copy->values.reserve(width);
+                copy->values = ptr->values;
+            }
+            ptr.reset(copy);
+        }
+        return *ptr;
+    }
+
+    // removes the element at _size below ptr, drops emptied nodes
+    void pop(linked_ptr<node>& ptr, unsigned level) {
+        node& n = editable(ptr, level);
+        if (level == 0) {
+            n.values.pop_back();
+            return;
+        }
+        std::size_t index = (_size >> level) & mask;
+        pop(n.children[index], level - bits);
+        linked_ptr<node>& child = n.children[index];
+        if (child->children.empty() && child->values.empty())
+            n.children.pop_back();
+    }
+
+    linked_ptr<node> _root;
+    std::size_t _size = 0;
+    // level of the root: leaves are at 0
+    unsigned _shift = 0;
+};
+
+} // namespace smart_ptr
+
+#endif // PERSISTENT_VECTOR_H
@@ -0,0 +1,41 @@
+#!/bin/sh
+# Checks that linked_ptr<T> with the default policy compiles to the same
+# instructions as the linked_ptr.h of REF, the class before the policies
+# by default. The codegen_* functions of bench/policy_bench.cpp are
+# built against both headers and their disassembly compared.
+#
+# usage: check_default_policy.sh [REF]   (run from the repository, needs objdump)
+
+set -eu
+
+cd "$(git rev-parse --show-toplevel)"
+if [ $# -gt 0 ]; then
+    ref=$1
+else
+    introduced=$(git log --reverse --format=%H -S linked_ptr_policy -- linked_ptr.h | head -n 1)
+    ref=${introduced:+$introduced^}
+    ref=${ref:-HEAD}
+fi
+cxx=${CXX:-c++}
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+mkdir "$work/old"
+git show "$ref:linked_ptr.h" > "$work/old/linked_ptr.h"
+
+disassemble() {
+    "$cxx" -std=c++14 -O2 -DNDEBUG -DCODEGEN_ONLY -I "$1" -c bench/policy_bench.cpp -o "$2.o"
+    # without the addresses, which move with the rest of the object
+    objdump -d --no-show-raw-insn "$2.o" | sed -n '/<codegen_/,$p' \
+        | sed -E 's/^ *[0-9a-f]+:[[:space:]]*//; s/[0-9a-f]+ <([^>]*)>/<\1>/g' > "$2.s"
+}
+
+disassemble "$work/old" "$work/old"
+disassemble . "$work/new"
+
+if diff -u "$work/old.s" "$work/new.s"; then
+    echo "default policy: same code as linked_ptr.h at $ref ($(grep -c '^<codegen_' "$work/new.s") functions)"
+else
+    echo "default policy: the code differs from linked_ptr.h at $ref" >&2
+    exit 1
+fi
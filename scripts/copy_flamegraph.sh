@@ -0,0 +1,53 @@
+#!/bin/sh
+# Per-type flame graph of linked_ptr copies, from the USDT probes of a
+# binary built with -DLINKED_PTR_TRACE (needs bpftrace, root, and
+# flamegraph.pl from https://github.com/brendangregg/FlameGraph in PATH
+# for the svg; otherwise the folded stacks are printed).
+#
+# usage: copy_flamegraph.sh BINARY [SECONDS] [PROBE]
+#   PROBE is one of construct, copy, reset, swap, destroy (default copy)
+
+set -eu
+
+binary=$(realpath "$1")
+seconds=${2:-10}
+probe=${3:-copy}
+folded=$(mktemp)
+trap 'rm -f "$folded"' EXIT
+
+# arg3 is the mangled type name, which becomes the root frame
+bpftrace -q -e "
+usdt:$binary:linked_ptr:$probe { @[str(arg3), ustack(perf)] = count(); }
+interval:s:$seconds { exit(); }
+" | python3 -c '
+import re, subprocess, sys
+
+def demangle(name):
+    try:
+        return subprocess.run(["c++filt", "-t", name], capture_output=True, text=True).stdout.strip() or name
+    except OSError:
+        return name
+
+stacks, key = [], None
+for line in sys.stdin:
+    line = line.rstrip("\n")
+    if line.startswith("@["):
+        key = [demangle(line[2:].rstrip().rstrip(","))]
+        frames = []
+    elif key is not None and line.startswith("]:"):
+        # bpftrace prints the innermost frame first
+        stacks.append(";".join(key + frames[::-1]) + " " + line[2:].strip())
+        key = None
+    elif key is not None and line.strip():
+        # "        7f12... function+0x1f (/path/binary)"
+        parts = line.split()
+        frames.append(re.sub(r"\+0x[0-9a-f]+$", "", parts[1]) if len(parts) > 1 else parts[0])
+print("\n".join(stacks))
+' > "$folded"
+
+if command -v flamegraph.pl >/dev/null 2>&1; then
+    flamegraph.pl --title "linked_ptr $probe by type" "$folded" > "linked_ptr_$probe.svg"
+    echo "linked_ptr_$probe.svg"
+else
+    cat "$folded"
+fi
@@ -0,0 +1,226 @@
+#ifndef SHARDED_PTR_H
+#define SHARDED_PTR_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include "linked_ptr.h"
+
+namespace smart_ptr {
+
+namespace details {
+
+    // the object of a sharded_ptr with the number of threads owning it
+    struct shard_anchor {
+        std::atomic<std::size_t> shards{1};
+        void (*destroy)(shard_anchor*);
+    };
+
+    template <typename T>
+    struct sharded_object : shard_anchor {
+        explicit sharded_object(T* p) noexcept : ptr(p) {
+            destroy = [](shard_anchor* anchor) {
+                auto* self = static_cast<sharded_object*>(anchor);
+                debug_release(self->ptr);
+                delete self->ptr;
+                delete self;
+            };
+        }
+
+        T* ptr;
+    };
+
+    inline const void* shard_thread() noexcept {
+        static thread_local const char tag = 0;
+        return &tag;
+    }
+
+    // the owners of an object on one thread: a ring around head
+    struct shard {
+        explicit shard(shard_anchor* a) noexcept : anchor(a), thread(shard_thread()) {}
+
+        linked_ptr_base head;
+        shard_anchor* anchor;
+        const void* thread;
+    };
+
+    // the shards of this thread, by object
+    inline std::unordered_map<const shard_anchor*, shard*>& shard_table() {
+        static thread_local std::unordered_map<const shard_anchor*, shard*> table;
+        return table;
+    }
+
+    inline shard* make_shard(shard_anchor* anchor) {
+        std::unique_ptr<shard> s(new shard(anchor));
+        shard_table().emplace(anchor, s.get());
+        return s.release();
+    }
+
+    // the shard of anchor on this thread, the thread joins the owners
+    // of the object if it has none
+    inline shard* local_shard(shard_anchor* anchor) {
+        auto& table = shard_table();
+        auto it = table.find(anchor);
+        if (it != table.end())
+            return it->second;
+        shard* s = make_shard(anchor);
+        anchor->shards.fetch_add(1, std::memory_order_relaxed);
+        return s;
+    }
+
+    // the last owner on this thread is gone
+    inline void leave_shard(shard* s) noexcept {
+        shard_anchor* anchor = s->anchor;
+        shard_table().erase(anchor);
+        delete s;
+        if (anchor->shards.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            anchor->destroy(anchor);
+    }
+
+} // namespace details
+
+/// Ownership of an object copied on many threads at once: every thread
+/// keeps its owners in a ring of its own (a shard), and only a shard
+/// becoming non-empty or empty touches the shared counter of threads.
+/// A copy of an owner of the same thread links into its ring without
+/// any atomic; a copy of an owner of another thread looks up this
+/// thread's shard (and makes it on the first copy), so copy from a
+/// local owner on the hot path.
+///
+/// An owner may be copied from any thread, but it is changed and
+/// destroyed only on the thread which made it.
+template <typename T>
+class sharded_ptr {
+    template <typename Y>
+    using type_compatible = std::enable_if_t<std::is_convertible<Y*, T*>::value>;
+
+public:
+    using element_type = T;
+
+    sharded_ptr() noexcept = default;
+
+    template <typename Y, typename = type_compatible<Y> >
+    explicit sharded_ptr(Y* ptr) {
+        acquire(ptr);
+    }
+
+    sharded_ptr(const sharded_ptr& rhs) {
+        join(rhs);
+    }
+
+    ~sharded_ptr() {
+        release();
+    }
+
+    sharded_ptr& operator=(const sharded_ptr& rhs) {
+        sharded_ptr tmp(rhs);
+        swap(tmp);
+        return *this;
+    }
+
+    // Info
+
+    T* get() const noexcept {
+        return _ptr;
+    }
+
+    T& operator*() const noexcept {
+        return *_ptr;
+    }
+
+    T* operator->() const noexcept {
+        return _ptr;
+    }
+
+    explicit operator bool() const noexcept {
+        return _ptr != nullptr;
+    }
+
+    /// The only owner on its thread
+    bool unique_on_thread() const noexcept {
+        return _shard != nullptr && _node._right == &_shard->head && _node.left() == &_shard->head;
+    }
+
+    /// Number of threads owning the object, a hint while they change
+    std::size_t shards() const noexcept {
+        return _shard != nullptr ? _shard->anchor->shards.load(std::memory_order_relaxed) : 0;
+    }
+
+    // Modification
+
+    template <typename Y, typename = type_compatible<Y> >
+    void reset(Y* ptr) {
+        release();
+        acquire(ptr);
+    }
+
+    void reset() noexcept {
+        release();
+    }
+
+    /// Both owners belong to this thread
+    void swap(sharded_ptr& other) noexcept {
+        if (_ptr == other._ptr)
+            return;
+        _node.swap(other._node);
+        std::swap(_ptr, other._ptr);
+        std::swap(_shard, other._shard);
+    }
+
+private:
+    template <typename Y>
+    void acquire(Y* ptr) {
+        if (ptr == nullptr)
+            return;
+        // like std::shared_ptr, ptr is deleted if the owner cannot be made
+        details::sharded_object<T>* object = nullptr;
+        try {
+            object = new details::sharded_object<T>(static_cast<T*>(ptr));
+            _shard = details::make_shard(object);
+        } catch (...) {
+            delete object;
+            delete ptr;
+            throw;
+        }
+        details::debug_acquire(object->ptr);
+        _node.insert_after(_shard->head);
+        _ptr = object->ptr;
+    }
+
+    void join(const sharded_ptr& rhs) {
+        if (rhs._shard == nullptr)
+            return;
+        if (rhs._shard->thread == details::shard_thread()) {
+            _shard = rhs._shard;
+            _node.insert_after(rhs._node);
+        } else {
+            _shard = details::local_shard(rhs._shard->anchor);
+            _node.insert_after(_shard->head);
+        }
+        _ptr = rhs._ptr;
+    }
+
+    void release() noexcept {
+        if (_shard == nullptr)
+            return;
+        assert(_shard->thread == details::shard_thread());
+        _node.erase();
+        if (_shard->head.unique())
+            details::leave_shard(_shard);
+        _shard = nullptr;
+        _ptr = nullptr;
+    }
+
+    T* _ptr = nullptr;
+    details::shard* _shard = nullptr;
+    mutable details::linked_ptr_base _node;
+};
+
+} // namespace smart_ptr
+
+#endif // SHARDED_PTR_H